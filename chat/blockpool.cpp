@@ -0,0 +1,43 @@
+#include "blockpool.h"
+
+namespace
+{
+thread_local bool t_poolDestroyed = false;
+}
+
+BlockPool *BlockPool::local()
+{
+    if (t_poolDestroyed)
+        return nullptr;
+    static thread_local BlockPool pool;
+    return &pool;
+}
+
+BlockPool::~BlockPool()
+{
+    t_poolDestroyed = true;
+    for (Block *block : free_)
+        delete block;
+}
+
+Block *BlockPool::acquire()
+{
+    BlockPool *pool = local();
+    if (!pool || pool->free_.empty())
+        return new Block;
+
+    Block *block = pool->free_.back();
+    pool->free_.pop_back();
+    return block;
+}
+
+void BlockPool::release(Block *block)
+{
+    BlockPool *pool = local();
+    if (!pool || pool->free_.size() >= kMaxFree)
+    {
+        delete block;
+        return;
+    }
+    pool->free_.push_back(block);
+}
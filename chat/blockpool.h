@@ -0,0 +1,81 @@
+#pragma once
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Block — Buffer 链中的固定大小内存块，带引用计数
+ *
+ * Buffer 与从中切出的 BufferSlice 通过 BlockRef 共享同一块内存，
+ * 最后一个引用释放时归还给当前线程的 BlockPool。
+ */
+struct Block
+{
+    static constexpr size_t kSize = 16 * 1024;
+
+    std::atomic<int> refs{0};
+    char data[kSize];
+};
+
+/**
+ * BlockPool — 每线程一个的 Block 空闲链表（slab）
+ *
+ * 分配 / 归还都只访问本线程的链表，无锁；在其他线程释放的 Block 归还到该线程的池。
+ * 空闲块超过 kMaxFree 时直接交还给系统，避免某个线程囤积内存。
+ */
+class BlockPool
+{
+public:
+    static constexpr size_t kMaxFree = 256;   // 每线程最多缓存 4MB
+
+    // 线程退出、本线程的池已析构后仍可调用，此时直接走 new / delete
+    static Block *acquire();
+    static void release(Block *block);
+
+    ~BlockPool();
+
+private:
+    BlockPool() = default;
+    static BlockPool *local();
+
+    std::vector<Block *> free_;
+};
+
+// Block 的侵入式引用
+class BlockRef
+{
+public:
+    BlockRef() = default;
+    explicit BlockRef(Block *block) : block_(block) { if (block_) block_->refs.fetch_add(1, std::memory_order_relaxed); }
+    BlockRef(const BlockRef &rhs) : BlockRef(rhs.block_) {}
+    BlockRef(BlockRef &&rhs) noexcept : block_(rhs.block_) { rhs.block_ = nullptr; }
+    ~BlockRef() { reset(); }
+
+    BlockRef &operator=(BlockRef rhs) noexcept
+    {
+        std::swap(block_, rhs.block_);
+        return *this;
+    }
+
+    static BlockRef allocate() { return BlockRef(BlockPool::acquire()); }
+
+    void reset()
+    {
+        if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            BlockPool::release(block_);
+        block_ = nullptr;
+    }
+
+    char *data() const { return block_->data; }
+    bool unique() const { return block_->refs.load(std::memory_order_acquire) == 1; }
+    explicit operator bool() const { return block_ != nullptr; }
+
+private:
+    Block *block_ = nullptr;
+};
+
+#endif
@@ -1,79 +1,185 @@
 #include "buffer.h"
 
-// 扩容与空间回收组
-void Buffer::ensureWritable(size_t len)
+#include <algorithm>
+#include <cerrno>
+
+std::string BufferSlice::toString() const
+{
+    std::string str;
+    str.reserve(size_);
+    for (const Piece &piece : pieces_)
+        str.append(piece.data(), piece.len);
+    return str;
+}
+
+BufferSlice BufferSlice::sub(size_t pos, size_t len) const
 {
-    if (writableBytes() < len)
+    assert(pos + len <= size_);
+    BufferSlice slice;
+    slice.size_ = len;
+    for (const Piece &piece : pieces_)
     {
-        makeSpace(len);
+        if (len == 0)
+            break;
+        if (pos >= piece.len)
+        {
+            pos -= piece.len;
+            continue;
+        }
+        size_t n = std::min(len, piece.len - pos);
+        slice.pieces_.push_back({piece.block, piece.offset + pos, n});
+        len -= n;
+        pos = 0;
     }
+    return slice;
 }
 
-char *Buffer::beginWrite() { return begin() + writePos; }
-const char *Buffer::beginWrite() const { return begin() + writePos; }
+// 读取组
+void Buffer::retrieve(size_t len)
+{
+    assert(len <= readableBytes());
+    if (len == readable_)
+    {
+        retrieveAll();
+        return;
+    }
 
-void Buffer::append(const std::string &str)
+    readable_ -= len;
+    while (len > 0)
+    {
+        size_t inFront = (blocks_.size() == 1 ? writePos_ : Block::kSize) - readPos_;
+        if (len < inFront)
+        {
+            readPos_ += len;
+            return;
+        }
+        len -= inFront;
+        blocks_.pop_front();
+        readPos_ = 0;
+    }
+}
+
+void Buffer::retrieveAll()
 {
-    append(str.c_str(), str.size());
+    // 读空即归还所有块
+    blocks_.clear();
+    readPos_ = 0;
+    writePos_ = 0;
+    readable_ = 0;
+}
+
+void Buffer::copyOut(char *dst, size_t len) const
+{
+    size_t offset = readPos_;
+    for (size_t i = 0; len > 0; ++i)
+    {
+        size_t end = (i + 1 == blocks_.size()) ? writePos_ : Block::kSize;
+        size_t n = std::min(len, end - offset);
+        ::memcpy(dst, blocks_[i].data() + offset, n);
+        dst += n;
+        len -= n;
+        offset = 0;
+    }
 }
 
-void Buffer::append(const char *str, size_t len)
+std::string Buffer::retrieveAsString(size_t len)
 {
-    ensureWritable(len);
-    std::copy(str, str + len, beginWrite());
-    writePos += len;
+    assert(len <= readableBytes());
+    std::string str(len, '\0');
+    copyOut(&str[0], len);
+    retrieve(len);
+    return str;
 }
 
-// 确保空间
-void Buffer::makeSpace(size_t len)
+BufferSlice Buffer::retrieveAsSlice(size_t len)
 {
-    if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+    assert(len <= readableBytes());
+    BufferSlice slice;
+    slice.size_ = len;
+
+    size_t offset = readPos_;
+    for (size_t i = 0; len > 0; ++i)
     {
-        buffer.resize(writePos + len);
+        size_t end = (i + 1 == blocks_.size()) ? writePos_ : Block::kSize;
+        size_t n = std::min(len, end - offset);
+        slice.pieces_.push_back({blocks_[i], offset, n});
+        len -= n;
+        offset = 0;
     }
-    else
+
+    retrieve(slice.size_);
+    return slice;
+}
+
+// 追加组
+void Buffer::append(const std::string &str)
+{
+    append(str.c_str(), str.size());
+}
+
+void Buffer::append(const char *data, size_t len)
+{
+    readable_ += len;
+    while (len > 0)
     {
-        size_t readable = readableBytes();
-        std::copy(begin() + readPos, begin() + writePos, begin() + kCheapPrepend);
-        readPos = kCheapPrepend;
-        writePos = readPos + readable;
+        if (tailRoom() == 0)
+        {
+            blocks_.push_back(BlockRef::allocate());
+            writePos_ = 0;
+        }
+        size_t n = std::min(len, tailRoom());
+        ::memcpy(blocks_.back().data() + writePos_, data, n);
+        writePos_ += n;
+        data += n;
+        len -= n;
     }
 }
 
 // 读文件
 ssize_t Buffer::readFd(int fd, int *err)
 {
-    // 栈空间
-    char extrabuf[65536];
-
-    struct iovec vec[2];
-    const size_t writable = writableBytes();
-
-    vec[0].iov_base = begin() + writePos;
-    vec[0].iov_len = writable;
-
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
-
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    // 末块剩余空间 + 若干备用块，一次 readv 直接读进 Block，不再经过栈上中转
+    BlockRef spare[kReadBlocks];
+    struct iovec vec[kReadBlocks + 1];
+    int iovcnt = 0;
 
-    const ssize_t n = readv(fd, vec, iovcnt); // 读入所有数据
+    const size_t room = tailRoom();
+    if (room > 0)
+    {
+        vec[iovcnt].iov_base = blocks_.back().data() + writePos_;
+        vec[iovcnt].iov_len = room;
+        ++iovcnt;
+    }
+    for (int i = 0; i < kReadBlocks; ++i)
+    {
+        spare[i] = BlockRef::allocate();
+        vec[iovcnt].iov_base = spare[i].data();
+        vec[iovcnt].iov_len = Block::kSize;
+        ++iovcnt;
+    }
 
+    const ssize_t n = ::readv(fd, vec, iovcnt);
     if (n < 0)
     {
         *err = errno;
+        return n;
     }
-    else if (static_cast<size_t>(n) <= writable)
-    {
-        writePos += n;
-    }
-    else
+
+    size_t left = static_cast<size_t>(n);
+    readable_ += left;
+
+    size_t inTail = std::min(left, room);
+    writePos_ += inTail;
+    left -= inTail;
+
+    // 用到的备用块挂到链尾，没用到的随 spare 析构还回池
+    for (int i = 0; left > 0; ++i)
     {
-        writePos = buffer.size();
-        append(extrabuf, n - writable);
+        size_t used = std::min(left, Block::kSize);
+        blocks_.push_back(std::move(spare[i]));
+        writePos_ = used;
+        left -= used;
     }
-    //错误码/buffer够用//不够用
 
     return n;
 }
-
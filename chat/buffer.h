@@ -2,72 +2,86 @@
 #ifndef BUFFER_H
 #define BUFFER_H
 
+#include <deque>
 #include <vector>
-#include <atomic>
 #include <cassert>
 #include <string>
 #include <arpa/inet.h>  // htonl, ntohl
 #include <cstring>      // perror, memcpy
 #include <sys/uio.h>    // struct iovec, readv, writev
+#include "blockpool.h"
+
+/**
+ * BufferSlice — 从 Buffer 中切出的一段只读数据
+ *
+ * 持有所在 Block 的引用，不拷贝数据；Buffer 之后继续读写或析构都不影响它。
+ * 跨 Block 时由多段组成，需要连续内存时再 toString()。
+ */
+class BufferSlice
+{
+public:
+    struct Piece
+    {
+        BlockRef block;
+        size_t offset;
+        size_t len;
+
+        const char *data() const { return block.data() + offset; }
+    };
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // 只落在一个 Block 内时可直接用 data() 访问
+    bool contiguous() const { return pieces_.size() <= 1; }
+    const char *data() const
+    {
+        assert(contiguous());
+        return pieces_.empty() ? nullptr : pieces_.front().data();
+    }
+    const std::vector<Piece> &pieces() const { return pieces_; }
+
+    std::string toString() const;
+    // [pos, pos + len) 部分，同样不拷贝
+    BufferSlice sub(size_t pos, size_t len) const;
 
+private:
+    friend class Buffer;
+    std::vector<Piece> pieces_;
+    size_t size_ = 0;
+};
+
+/**
+ * Buffer — 由固定大小 Block 串成的链式缓冲区
+ *
+ * Block 取自每线程的 BlockPool；追加只会在末块之后挂新块，不会整体搬移或扩容，
+ * 大包不再触发 realloc。数据读空后立即把所有块还给池，空闲连接不占内存。
+ * 仅由所属 Session 单线程访问，读写位置不需要原子操作。
+ */
 class Buffer
 {
 
 public:
-    static const size_t kCheapPrepend = 8;
-    static const size_t kInitialSize = 1024;
+    // 一次 readFd 最多额外挂上的新块数（64KB）
+    static constexpr int kReadBlocks = 4;
 
-    explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer(kCheapPrepend + initialSize),
-          readPos(kCheapPrepend),
-          writePos(kCheapPrepend) {}
+    Buffer() = default;
 
     // 可读字节数
-    size_t readableBytes() const { return writePos - readPos; }
-    // 可写字节数
-    size_t writableBytes() const { return buffer.size() - writePos; }
-    // 头部预留字节数
-    size_t prependableBytes() const { return readPos; }
-    
-public:
-    // 协议感知组    
-    // 获取可读数据的起始
-    const char *peek() const { return begin() + readPos; }
+    size_t readableBytes() const { return readable_; }
+    // 当前持有的 Block 数
+    size_t blockCount() const { return blocks_.size(); }
 
-    void retrieve(size_t len)
-    {
-        assert(len <= readableBytes());
-        if (len < readableBytes())
-        {
-            readPos += len;
-        }
-        else
-        {
-            retrieveAll();
-        }
-    }
-
-    void retrieveAll()
-    {
-        readPos = kCheapPrepend;
-        writePos = kCheapPrepend;
-    }
+public:
+    // 协议感知组
+    void retrieve(size_t len);
+    void retrieveAll();
 
     // 读出并返回字符串用于解析json
-    std::string retrieveAllAsString()
-    {
-        std::string str(peek(), readableBytes());
-        retrieveAll();
-        return str;
-    }
+    std::string retrieveAllAsString() { return retrieveAsString(readable_); }
+    std::string retrieveAsString(size_t len);
 
-    std::string retrieveAsString(int32_t len)
-    {
-        assert(len <= readableBytes());
-        std::string str(peek(), len);
-        retrieve(len);
-        return str;
-    }
+    // 零拷贝取出 len 字节
+    BufferSlice retrieveAsSlice(size_t len);
 
 public:
     // 字节序转换组
@@ -79,8 +93,8 @@ public:
 
     int32_t readInt32()
     {
-        int32_t result = peekInt32(); 
-        retrieve(sizeof(int32_t));    
+        int32_t result = peekInt32();
+        retrieve(sizeof(int32_t));
         return result;
     }
 
@@ -88,17 +102,14 @@ public:
     {
         assert(readableBytes() >= sizeof(int32_t));
         int32_t be32 = 0;
-        ::memcpy(&be32, peek(), sizeof(int32_t));
+        copyOut(reinterpret_cast<char *>(&be32), sizeof(int32_t)); // 长度头可能跨块
         return ntohl(be32); // 网络序 → 主机序
     }
 
-public: 
-    //扩容与空间回收组
+public:
+    // 追加组
     void append(const std::string &str);
     void append(const char *data, size_t len);
-    void ensureWritable(size_t len);
-    char *beginWrite();
-    const char *beginWrite() const;
 
 public:
     // 读写文件描述符
@@ -106,13 +117,13 @@ public:
 
 
 private:
-    char *begin() { return buffer.data(); }
-    const char *begin() const { return buffer.data(); }
-    void makeSpace(size_t len);
+    size_t tailRoom() const { return blocks_.empty() ? 0 : Block::kSize - writePos_; }
+    void copyOut(char *dst, size_t len) const;   // 从读位置拷出 len 字节，不移动读位置
 
-    std::vector<char> buffer;  
-    std::atomic<size_t> readPos;  //读起始位置
-    std::atomic<size_t> writePos; //写起始位置
+    std::deque<BlockRef> blocks_;
+    size_t readPos_ = 0;   // 首块中的读位置
+    size_t writePos_ = 0;  // 末块中的写位置
+    size_t readable_ = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
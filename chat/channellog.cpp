@@ -0,0 +1,54 @@
+#include "channellog.h"
+#include <algorithm>
+
+void ChannelLog::beginPost(int channelId)
+{
+    Shard &shard = shardOf(channelId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.channels[channelId].pending;
+}
+
+void ChannelLog::endPost(int channelId, int64_t msgId)
+{
+    Shard &shard = shardOf(channelId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    State &state = shard.channels[channelId];
+    state.maxPushed = std::max(state.maxPushed, msgId);
+    // 此前开始的发帖都已推送完；之后开始的发帖写入更晚，id 必然更大
+    if (--state.pending == 0)
+        state.stable = state.maxPushed;
+}
+
+int64_t ChannelLog::stableHead(int channelId) const
+{
+    const Shard &shard = shardOf(channelId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.channels.find(channelId);
+    return it != shard.channels.end() ? it->second.stable : 0;
+}
+
+ChannelLog::Post::Post(int channelId)
+    : channelId_(channelId), active_(true)
+{
+    ChannelLog::getInstance().beginPost(channelId_);
+}
+
+ChannelLog::Post::Post(Post &&other) noexcept
+    : channelId_(other.channelId_), active_(other.active_)
+{
+    other.active_ = false;
+}
+
+ChannelLog::Post::~Post()
+{
+    if (active_)
+        ChannelLog::getInstance().endPost(channelId_, 0);
+}
+
+void ChannelLog::Post::finish(int64_t msgId)
+{
+    if (!active_)
+        return;
+    active_ = false;
+    ChannelLog::getInstance().endPost(channelId_, msgId);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef CHANNEL_LOG_H
+#define CHANNEL_LOG_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * ChannelLog — 频道日志的推送进度（单例）
+ *
+ * 频道消息只追加到 ChannelMessage 表一次，成员在 GroupMember.read_cursor 记录读到的位置，
+ * 登录时拉取游标之后的部分；在线成员仍经正常 Session 路径实时推送。
+ *
+ * 这里记录每个频道的"稳定水位"：所有 msgId 不超过它的消息都已完成实时推送。
+ * 每次发帖持有一个 Post：构造时登记在途，推送后 finish，在途发帖数归零时水位推进到已推送的最大 id；
+ * 未 finish 就销毁（排队被拒、写入失败、异常）按失败处理，在途数不会卡在非零。
+ * 在线期间一直收着推送、且下线时发送积压已写空的成员可把游标推进到这个水位，而不会跳过仍在途的消息；
+ * 并发发帖时水位会暂时滞后，代价只是下次登录重复收到几条（客户端按 msgId 去重）。
+ */
+class ChannelLog
+{
+public:
+    static ChannelLog &getInstance()
+    {
+        static ChannelLog instance;
+        return instance;
+    }
+
+    ChannelLog(const ChannelLog &) = delete;
+    ChannelLog &operator=(const ChannelLog &) = delete;
+
+    // 一次发帖的在途登记（只可移动）
+    class Post
+    {
+    public:
+        explicit Post(int channelId);
+        Post(Post &&other) noexcept;
+        Post(const Post &) = delete;
+        Post &operator=(const Post &) = delete;
+        Post &operator=(Post &&) = delete;
+        ~Post();
+
+        void finish(int64_t msgId);   // 已推送完 msgId；之后的析构不再重复登记
+
+    private:
+        int  channelId_;
+        bool active_;
+    };
+
+    int64_t stableHead(int channelId) const;      // 本进程内尚未有推送时为 0
+
+    static constexpr size_t kShardCount = 64;   // 2 的幂
+
+private:
+    ChannelLog() = default;
+
+    void beginPost(int channelId);
+    void endPost(int channelId, int64_t msgId);   // 写入失败传 0
+
+    struct State
+    {
+        int     pending   = 0;   // 在途发帖数
+        int64_t maxPushed = 0;
+        int64_t stable    = 0;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<int, State> channels;
+    };
+
+    Shard &shardOf(int channelId) { return shards_[static_cast<size_t>(channelId) & (kShardCount - 1)]; }
+    const Shard &shardOf(int channelId) const { return shards_[static_cast<size_t>(channelId) & (kShardCount - 1)]; }
+
+    std::array<Shard, kShardCount> shards_;
+};
+
+#endif
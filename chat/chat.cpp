@@ -2,23 +2,195 @@
 #include <sys/socket.h>
 #include <iostream>
 #include <sys/epoll.h>
-#include <unordered_set>
 #include <vector>
 #include <cstring>
+#include <algorithm>
 #include "usermanager.h"
+#include "friendcache.h"
+#include "groupcache.h"
+#include "channellog.h"
+#include "presencenotifier.h"
+#include "credentialcache.h"
 #include "../mysql/sqlConnectionPool.h"
+#include "../mysql/dbexecutor.h"
+#include "../reactor/eventloop.h"
+#include "../reactor/timingwheel.h"
+#include "jsonscan.h"
 
-std::function<void(int, uint32_t)> ChatSession::ModEpollCallback = nullptr;
+OutputLimits ChatSession::s_outputLimits;
+OfflineAck   ChatSession::s_offlineAck = OfflineAck::AfterFlush;
 
-ChatSession::ChatSession(int fd) : socketFd(fd), userId(0), isLogin(false), isClosed(false)
+namespace
 {
-    lastActiveTime = time(nullptr);
-    initHandlers();
+// 当前线程正在执行其 strand 的 Session
+thread_local ChatSession* t_strandSession = nullptr;
+
+// 频道日志：每次拉取的最大条数
+constexpr size_t kChannelPageSize = 200;
+
+// 离线消息：每页最大条数
+constexpr size_t kOfflinePageSize = 200;
+
+// 在线状态在网络线程上按在线位图补齐，代价只与好友数有关
+void markOnline(json &friends)
+{
+    std::vector<int> ids;
+    ids.reserve(friends.size());
+    for (const auto &f : friends)
+        ids.push_back(f["id"].get<int>());
+
+    std::vector<uint8_t> online = UserManager::getInstance().onlineMask(ids);
+    for (size_t i = 0; i < ids.size(); ++i)
+        friends[i]["online"] = online[i] != 0;
+}
+
+// 在 DbExecutor 线程执行：好友 id 列表，供上下线推送使用（不回给客户端）
+json loadFriendIds(SqlConn *conn, int userId)
+{
+    json friends = json::array();
+    SqlStatement &friendIds = conn->stmt(StmtId::FriendIds);
+    if (friendIds.execute(userId)) {
+        while (friendIds.fetch())
+            friends.push_back(friendIds.getInt(0));
+    }
+    return friends;
+}
+
+// 在 DbExecutor 线程执行：校验账号，成功时同一次借用顺带加载好友 id
+json verifyLogin(SqlConn *conn, const std::string &user, const std::string &pwd)
+{
+    if (!conn)
+        return {{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+
+    SqlStatement &login = conn->stmt(StmtId::Login);
+    if (!login.execute(user, pwd))
+        return {{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "query error"}};
+    if (!login.fetch())
+        return {{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "wrong username or password"}};
+
+    int dbUserId = login.getInt(0);
+    std::string nickname = login.isNull(1) ? user : login.getString(1);
+
+    // 好友关系图里已有这一行（另一端在线或刚下线）时不再查 Friend 表
+    json friends;
+    uint64_t friendStamp = FriendCache::getInstance().stamp(dbUserId);
+    if (FriendCache::List cached = FriendCache::getInstance().get(dbUserId))
+        friends = *cached;
+    else
+        friends = loadFriendIds(conn, dbUserId);
+
+    return {{"type", "LOGIN_RESP"}, {"success", true},
+            {"userId", dbUserId}, {"nickname", nickname}, {"msg", "login success"},
+            {"friends", std::move(friends)}, {"friendStamp", friendStamp}};
+}
+
+// 在 DbExecutor 线程执行：取游标之后的一页频道消息。只读不写：read_cursor 等下发的帧
+// 真正写进 socket 后由 persistChannelCursors 推进，掉线时这一页下次登录会重新拉取
+json pullChannelPage(SqlConn *conn, int groupId, int64_t cursor)
+{
+    json messages = json::array();
+    int64_t last = cursor;
+    bool more = false;
+
+    SqlStatement &page = conn->stmt(StmtId::ChannelPage);
+    if (!page.execute(groupId, static_cast<long long>(cursor), static_cast<long long>(kChannelPageSize + 1))) {
+        std::cerr << "[Channel] pull error: " << page.error() << std::endl;
+        return {{"groupId", groupId}, {"after", cursor}, {"cursor", cursor}, {"more", false}, {"messages", std::move(messages)}};
+    }
+
+    while (page.fetch()) {
+        if (messages.size() == kChannelPageSize) {
+            more = true; // 多取的一行只用来判断是否还有下一页
+            continue;
+        }
+        last = page.getInt64(0);
+        messages.push_back({{"type", "GROUP_CHAT"}, {"groupId", groupId}, {"from", page.getInt(1)},
+                            {"content", page.getString(2)}, {"msgId", last}});
+    }
+
+    return {{"groupId", groupId}, {"after", cursor}, {"cursor", last}, {"more", more}, {"messages", std::move(messages)}};
+}
+}
+
+ChatSession::ChatSession(int fd, EventLoop* loop)
+    : socketFd(fd), userId(0), isLogin(false), isClosed(false), fdReleased_(false),
+      inFormat_(WireFormat::Json), format_(WireFormat::Json),
+      loop_(loop), writeArmed_(false), readArmed_(true), readPaused_(false), inEvents_(false), dbInFlight_(0), inFlightBytes_(0),
+      offlineCursor_(0), offlineAcked_(0),
+      inboxBytes_(0), outBytes_(0), pendingEvents_(0), scheduled_(false), droppedFrames_(0), offlineWaitDrain_(false)
+{
+    lastActiveTime = CoarseClock::now();
 }
 
 ChatSession::~ChatSession()
 {
     close();
+    releaseFd();
+}
+
+// ─── Strand ─────────────────────────────────────────────────────────────────
+// 同一 Session 的读、业务、写以及其他连接发来的帧都在所属线程上串行处理：
+//   内联模式（Sub-Reactor / io_uring）所属线程即 loop 线程；
+//   Worker 模式下由 runStrand 在任一 Worker 上执行，scheduled_ 保证同一时刻只有一个。
+bool ChatSession::inOwnerThread() const
+{
+    if (t_strandSession == this)
+        return true;
+    return loop_ && loop_->inlineSessions() && loop_->isInLoopThread();
+}
+
+void ChatSession::post(uint32_t events)
+{
+    pendingEvents_.fetch_or(events);
+    schedule();
+}
+
+void ChatSession::schedule()
+{
+    if (loop_ && !scheduled_.exchange(true))
+        loop_->schedule(shared_from_this());
+}
+
+void ChatSession::runStrand()
+{
+    ChatSession* outer = t_strandSession;
+    t_strandSession = this;
+
+    // 清除 scheduled_ 后再检查一次：期间到达的事件 / 帧若没能安排新的执行，就由本次继续处理
+    do
+    {
+        handleEvents(pendingEvents_.exchange(0));
+        scheduled_.store(false);
+    } while ((pendingEvents_.load() != 0 || !inbox_.empty() || !tasks_.empty())
+             && !scheduled_.exchange(true));
+
+    t_strandSession = outer;
+}
+
+void ChatSession::handleEvents(uint32_t events)
+{
+    if (events & kEvClose)
+        close();
+
+    if (isClosed)
+    {
+        drainTasks(); // 丢弃
+        drainInbox();
+        return;
+    }
+
+    inEvents_ = true;
+    if (events & kEvRead)
+        processRead();
+    drainTasks();
+    drainInbox();
+    inEvents_ = false;
+
+    if (events & kEvWrite)
+        writeArmed_ = false; // 已可写，由 finishEvents 直接写出
+
+    // EPOLLONESHOT 下事件触发后 fd 已被摘除关注，需要重新 arm
+    finishEvents(loop_ && loop_->rearmAfterEvent() && (events & (kEvRead | kEvWrite)));
 }
 
 // 核心功能组
@@ -28,8 +200,7 @@ void ChatSession::processRead()
     ssize_t n = inputBuffer.readFd(socketFd, &saveErrno);
     if (n > 0)
     {
-        lastActiveTime = time(nullptr);
-        handlePacket();
+        onInput();
     }
     else if (n == 0)
     {
@@ -44,81 +215,301 @@ void ChatSession::processRead()
     }
 }
 
-void ChatSession::processWrite()
+void ChatSession::processInput(const char* data, size_t len)
 {
     if (isClosed)
-        {return;}
+        return;
+    inputBuffer.append(data, len);
+
+    inEvents_ = true;
+    onInput();
+    inEvents_ = false;
+    finishEvents(false);
+}
+
+void ChatSession::onInput()
+{
+    lastActiveTime.store(CoarseClock::now(), std::memory_order_relaxed);
+    handlePacket();
+}
+
+void ChatSession::finishEvents(bool rearm)
+{
+    if (isClosed)
+        return;
+
+    // 写直通：没有在途的写请求时直接非阻塞写出，写不完才关注可写，省去一次事件循环往返
+    if (!writeArmed_ && loop_ && loop_->writeThrough() && !flush())
+        return;
+
+    if (!checkWatermarks())
+        return;
+
+    // 离线消息翻页：积压降到低水位后再取下一页，内存占用与积压条数无关
+    if (pendingOutput() <= s_outputLimits.lowWatermark)
+        resumeOfflinePull();
+
+    if (!loop_)
+        return;
+
+    bool wantRead  = !readPaused();
+    bool wantWrite = !outputQueue.empty();
+    if (rearm || wantRead != readArmed_ || wantWrite != writeArmed_)
+    {
+        readArmed_  = wantRead;
+        writeArmed_ = wantWrite;
+        loop_->updateEvents(this, wantRead, wantWrite);
+    }
+}
 
-    std::lock_guard<std::mutex> lock(bufferMutex_);
-    while (outputBuffer.readableBytes() > 0)
+// 把队列里的帧 writev 出去，直到写完或 EAGAIN；出错关闭连接并返回 false
+bool ChatSession::flush()
+{
+    struct iovec iov[OutputQueue::kMaxIov];
+    while (!outputQueue.empty())
     {
-        ssize_t n = write(socketFd, outputBuffer.peek(), outputBuffer.readableBytes());
+        int cnt = outputQueue.fillIov(iov, OutputQueue::kMaxIov);
+        ssize_t n = ::writev(socketFd, iov, cnt);
         if (n > 0)
         {
-            outputBuffer.retrieve(n);
+            outputQueue.consume(n);
         }
-        else if (n < 0)
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
         {
-            if (errno == EAGAIN || errno == EWOULDBLOCK)
-            {
-                break;
-            }
-            close();
-            return;
+            break;
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
         }
         else
         {
-            return;
+            close();
+            return false;
         }
     }
-    if (outputBuffer.readableBytes() == 0 && ModEpollCallback) {
-        ModEpollCallback(socketFd, EPOLLIN | EPOLLET);
+    return true;
+}
+
+// 按积压调整读取：超过高水位暂停，降到低水位恢复；超过 hardLimit 视为慢消费者，断开
+bool ChatSession::checkWatermarks()
+{
+    size_t bytes = pendingOutput();
+    if (bytes > s_outputLimits.hardLimit)
+    {
+        std::cerr << "[Backpressure] userId=" << userId << " queued=" << bytes
+                  << " exceeds hard limit, disconnect" << std::endl;
+        close();   // 先关闭：积压未写出，频道游标不推进
+        outputQueue.clear();
+        outBytes_.store(0, std::memory_order_relaxed);
+        return false;
     }
+
+    if (!readPaused_ && bytes >= s_outputLimits.highWatermark)
+    {
+        readPaused_ = true;
+        std::cerr << "[Backpressure] userId=" << userId << " queued=" << bytes
+                  << " above high watermark, pause reading" << std::endl;
+    }
+    else if (readPaused_ && bytes <= s_outputLimits.lowWatermark)
+    {
+        readPaused_ = false;
+    }
+
+    outBytes_.store(bytes, std::memory_order_relaxed);
+    return true;
+}
+
+bool ChatSession::takeOutput(OutputQueue& out)
+{
+    if (isClosed || outputQueue.empty())
+    {
+        writeArmed_ = false;
+        return false;
+    }
+    // 取走的帧仍未写到 socket：继续计入积压，水位与离线翻页等发送完成后再评估
+    out.swap(outputQueue);
+    inFlightBytes_ = out.bytes();
+    return true;
 }
 
+void ChatSession::onSendProgress(size_t inFlight)
+{
+    inFlightBytes_ = inFlight;
+    if (isClosed)
+        return;
+
+    if (!checkWatermarks())
+        return;
+
+    if (pendingOutput() <= s_outputLimits.lowWatermark)
+        resumeOfflinePull();
+}
+
+// 可在任意线程调用：shutdown 让对端与所属 loop 都感知到关闭，
+// fd 本身由 loop 摘除后 releaseFd，避免 fd 号在仍有人引用时被复用
 void ChatSession::close()
 {
     if (isClosed.exchange(true))
         return;
 
-    if (socketFd >= 0)
-    {
-        ::close(socketFd);
-        socketFd = -1;
-    }
+    ::shutdown(socketFd, SHUT_RDWR);
 
     if (isLogin) {
-        UserManager::getInstance().removeSession(userId);
+        // 频道游标归 strand 所有：只在 strand 内关闭时推进，且要在摘除映射之前取稳定水位，
+        // 否则摘除后才完成的推送会被计入水位却从未发给本连接。其他线程上的关闭不推进，下次登录重新拉取
+        if (inOwnerThread())
+            persistChannelCursors();
+        // 先释放好友列表的引用，下线推送发布后即可回收
+        FriendCache::getInstance().release(userId);
+        UserManager::getInstance().removeSession(userId, this);
     }
 }
 
+void ChatSession::releaseFd()
+{
+    if (!fdReleased_.exchange(true))
+        ::close(socketFd);
+}
+
 // 发送接口
-void ChatSession::send(const json &message)
+void ChatSession::send(const json &message, SendPriority priority)
+{
+    // 按本连接协商的格式编码，编码在发送方线程完成
+    OutputQueue frame;
+    frame.push(codec::encodeFrame(message, format_.load(std::memory_order_relaxed)));
+    enqueue(std::move(frame), priority);
+}
+
+void ChatSession::send(const FramePtr &frame, SendPriority priority)
+{
+    OutputQueue q;
+    q.push(frame->encoded(format_.load(std::memory_order_relaxed)));
+    enqueue(std::move(q), priority);
+}
+
+// 转发文本 JSON：prefix + 原始片段 + suffix 组成包体，不经过 DOM
+// 本连接协商了二进制格式时才解析后重新编码
+void ChatSession::sendSpliced(const std::string &prefix, const BufferSlice &middle,
+                              const std::string &suffix, SendPriority priority)
+{
+    if (format_.load(std::memory_order_relaxed) != WireFormat::Json)
+    {
+        // 片段已由 jsonscan 校验，解析失败只丢弃这一帧，不影响发送方
+        json message = json::parse(prefix + middle.toString() + suffix, nullptr, false);
+        if (message.is_discarded())
+        {
+            std::cerr << "[ChatSession] spliced frame is not valid JSON, dropped" << std::endl;
+            return;
+        }
+        send(message, priority);
+        return;
+    }
+
+    uint32_t bodyLen = static_cast<uint32_t>(prefix.size() + middle.size() + suffix.size());
+    uint32_t be32 = htonl(bodyLen);
+
+    std::string head;
+    head.reserve(sizeof(be32) + prefix.size() + (middle.size() < kSpliceMinBytes ? middle.size() + suffix.size() : 0));
+    head.append(reinterpret_cast<const char *>(&be32), sizeof(be32));
+    head.append(prefix);
+
+    OutputQueue frame;
+    if (middle.size() < kSpliceMinBytes)
+    {
+        // 小片段直接拷进帧：引用整块 Block 会让慢消费者的积压远超 bytes() 统计
+        for (const BufferSlice::Piece &piece : middle.pieces())
+            head.append(piece.data(), piece.len);
+        head.append(suffix);
+        frame.push(std::move(head));
+    }
+    else
+    {
+        frame.push(std::move(head));
+        frame.push(middle);
+        frame.push(suffix);
+    }
+    enqueue(std::move(frame), priority);
+}
+
+// frame 为一个完整帧的若干段；所属线程直接入队，其他线程投递到 inbox
+void ChatSession::enqueue(OutputQueue &&frame, SendPriority priority)
+{
+    if (isClosed)
+        return;
+
+    if (inOwnerThread())
+    {
+        enqueueLocal(std::move(frame), priority);
+        if (!inEvents_)
+            finishEvents(false);
+        return;
+    }
+
+    // 背压：按发送队列与 inbox 的总积压提前丢弃，超过 hardLimit 的帧由所属线程断开前不再收
+    size_t queued = queuedBytes();
+    if ((priority == SendPriority::Low && queued >= s_outputLimits.highWatermark)
+        || queued > s_outputLimits.hardLimit)
+    {
+        droppedFrames_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    inboxBytes_.fetch_add(frame.bytes(), std::memory_order_relaxed);
+    inbox_.push(InboxItem{std::move(frame), priority});
+    schedule();
+}
+
+void ChatSession::enqueueLocal(OutputQueue &&frame, SendPriority priority)
 {
-    std::lock_guard<std::mutex> lock(bufferMutex_);
     if (isClosed)
         return;
 
-    std::string jsonStr = message.dump();
-    int32_t len = jsonStr.size();
+    // 背压：积压超过高水位时丢弃可丢弃的帧
+    if (priority == SendPriority::Low && pendingOutput() >= s_outputLimits.highWatermark)
+    {
+        droppedFrames_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-    outputBuffer.appendInt32(len);
-    outputBuffer.append(jsonStr);
+    outputQueue.append(std::move(frame));
+    outBytes_.store(pendingOutput(), std::memory_order_relaxed);
+}
 
-    if (ModEpollCallback)
+// 执行其他线程投递的任务；Session 已关闭时只丢弃
+void ChatSession::drainTasks()
+{
+    Task task;
+    while (tasks_.pop(task))
+    {
+        if (!isClosed)
+            task();
+        task = Task();
+    }
+}
+
+// 把其他线程发来的帧搬进发送队列，由随后的 finishEvents 一并写出
+void ChatSession::drainInbox()
+{
+    InboxItem item;
+    while (inbox_.pop(item))
     {
-        ModEpollCallback(socketFd, EPOLLIN | EPOLLOUT | EPOLLET);
+        inboxBytes_.fetch_sub(item.frame.bytes(), std::memory_order_relaxed);
+        enqueueLocal(std::move(item.frame), item.priority);
+        item.frame.clear();
     }
 }
 
 // 尝试解包
 void ChatSession::handlePacket()
 {
-    while (inputBuffer.readableBytes() >= 4)
+    while (!isClosed && dbInFlight_ == 0 && inputBuffer.readableBytes() >= 4)
     {
-        int32_t packetLen = inputBuffer.peekInt32();
-
-        if (packetLen < 0 || packetLen > 2 * 1024 * 1024)
+        // 包头高 2 位为包体编码，低 30 位为长度
+        WireFormat format;
+        uint32_t packetLen = 0;
+        if (!codec::parseHeader(static_cast<uint32_t>(inputBuffer.peekInt32()), format, packetLen)
+            || packetLen > 2 * 1024 * 1024)
         {
             std::cerr << "packetLen error" << std::endl;
             close();
@@ -131,73 +522,218 @@ void ChatSession::handlePacket()
         }
 
         inputBuffer.retrieve(4); // 跳过包头
-        std::string jsonStr = inputBuffer.retrieveAsString(packetLen);
+        BufferSlice body = inputBuffer.retrieveAsSlice(packetLen);
 
         try
         {
-            json message = json::parse(jsonStr);
+            // 热路径（CHAT / HEARTBEAT）直接扫描原文，不建 DOM
+            if (format == WireFormat::Json && handleFastPath(body))
+                continue;
+
+            // 包体落在单个 Block 内时直接在原地解析，跨块才拼接
+            json message;
+            if (body.contiguous())
+            {
+                message = codec::decode(body.data(), body.size(), format);
+            }
+            else
+            {
+                std::string bytes = body.toString();
+                message = codec::decode(bytes.data(), bytes.size(), format);
+            }
+            inFormat_ = format;
             dispatch(message);
         }
         catch (const std::exception &e)
         {
-            std::cerr << "json parse error" << std::endl;
+            std::cerr << "message decode error" << std::endl;
         }
     }
 }
 
-// 心跳检测
-bool ChatSession::checkTimeout(int timeoutSeconds)
+// 热路径：按需扫描文本 JSON 顶层字段，处理 CHAT / HEARTBEAT；
+// 其他类型或任何不合法、不确定的输入返回 false，交给 DOM 路径
+bool ChatSession::handleFastPath(const BufferSlice &body)
 {
-    time_t now = time(nullptr);
-    if (now - lastActiveTime > timeoutSeconds)
+    if (!isLogin)
+        return false;
+
+    std::string copy;
+    std::string_view text;
+    if (body.contiguous())
     {
-        close();
+        text = std::string_view(body.data(), body.size());
+    }
+    else
+    {
+        copy = body.toString();
+        text = copy;
+    }
+
+    std::string_view typeRaw, toRaw, contentRaw;
+    bool ok = jsonscan::forEachField(text, [&](const jsonscan::Field &field) {
+        if (field.keyEscaped)
+            return;
+        if (field.key == "type")
+            typeRaw = field.raw;
+        else if (field.key == "to")
+            toRaw = field.raw;
+        else if (field.key == "content")
+            contentRaw = field.raw;
+    });
+
+    std::string_view typeName;
+    if (!ok || !jsonscan::rawString(typeRaw, typeName))
+        return false;
+
+    switch (msgTypeFromName(typeName))
+    {
+    case MsgType::Heartbeat:
+        lastActiveTime.store(CoarseClock::now(), std::memory_order_relaxed);
+        return true;
+
+    case MsgType::Chat:
+    {
+        int toId = 0;
+        if (!jsonscan::rawInt(toRaw, toId) || contentRaw.empty() || contentRaw.front() != '"')
+            return false;
+        size_t contentPos = static_cast<size_t>(contentRaw.data() - text.data());
+        forwardChat(toId, body.sub(contentPos, contentRaw.size()));
         return true;
     }
-    return false;
+
+    default:
+        return false;
+    }
+}
+
+// content 为原文中的 JSON 字符串字面量（含引号），原样拼进转发帧
+void ChatSession::forwardChat(int toId, const BufferSlice &content)
+{
+    std::string prefix = "{\"type\":\"CHAT\",\"from\":" + std::to_string(userId)
+                       + ",\"to\":" + std::to_string(toId) + ",\"content\":";
+    static const std::string suffix = "}";
+
+    bool online = UserManager::getInstance().withSession(toId, [&](ChatSession &target) {
+        target.sendSpliced(prefix, content, suffix);
+    });
+    if (online)
+        return;
+
+    // 目标不在线，存入离线消息表（完成后回执）
+    storeOfflineMessage(toId, userId, prefix + content.toString() + suffix);
 }
 
 // 业务逻辑组(负责派活)
+
+// 分发表：新增消息类型时在 msgtype.h 登记协议名，在此登记处理函数
+const ChatSession::HandlerTable ChatSession::s_handlers = ChatSession::makeHandlerTable({
+    {MsgType::Login,       &ChatSession::handleLogin},
+    {MsgType::Register,    &ChatSession::handleRegister},
+    {MsgType::Chat,        &ChatSession::handleChat},
+    {MsgType::Heartbeat,   &ChatSession::handleHeartbeat},
+    {MsgType::AddFriend,   &ChatSession::handleAddFriend},
+    {MsgType::GetFriends,  &ChatSession::handleGetFriends},
+    {MsgType::GroupCreate, &ChatSession::handleGroupCreate},
+    {MsgType::GroupJoin,   &ChatSession::handleGroupJoin},
+    {MsgType::GroupLeave,  &ChatSession::handleGroupLeave},
+    {MsgType::GroupChat,   &ChatSession::handleGroupChat},
+    {MsgType::ChannelPull, &ChatSession::handleChannelPull},
+    {MsgType::OfflineAck,  &ChatSession::handleOfflineAck},
+});
+
 void ChatSession::dispatch(const json &message)
 {
-    if (!message.contains("type"))
+    auto typeIt = message.find("type");
+    if (typeIt == message.end() || !typeIt->is_string())
     {
         return;
     }
 
-    std::string type = message["type"];
+    // 直接引用 json 内部的字符串，驻留为 MsgType，不拷贝
+    const std::string &name = typeIt->get_ref<const std::string &>();
+    MsgType type = msgTypeFromName(name);
 
-    if (type != "LOGIN" && !isLogin)
+    if (type != MsgType::Login && !isLogin)
     {
         std::cout << "Unauthorized access!" << std::endl;
         return;
     }
 
-    auto it = handlers.find(type);
-    if (it != handlers.end())
+    Handler handler = s_handlers[static_cast<size_t>(type)];
+    if (handler)
     {
-        it->second(message);
+        (this->*handler)(message);
     }
     else
     {
-        std::cerr << "unknown message type: " << type << std::endl;
+        std::cerr << "unknown message type: " << name << std::endl;
     }
 }
 
-void ChatSession::initHandlers()
+// ─── 数据库异步执行 ──────────────────────────────────────────────────────────
+// work(SqlConn*) 在 DbExecutor 线程执行（连接不可用时传入 nullptr），返回的 json 交给
+// done 回到本 Session 的 strand 处理。在途期间暂停解析后续帧，请求与响应保持原有顺序。
+// 执行队列已满时立即回复 respType 的"服务繁忙"（respType 为空则只记录日志）并返回 false。
+template <typename Work, typename Done>
+bool ChatSession::submitDb(const char *respType, Work work, Done done)
+{
+    auto self = shared_from_this();
+    ++dbInFlight_;
+    bool ok = DbExecutor::getInstance().submit([self, respType, work = std::move(work), done = std::move(done)]() mutable {
+        json result;
+        bool failed = false;
+        try
+        {
+            auto conn = SqlConnPool::getInstance().getConn();
+            result = work(conn.get());
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[DbExecutor] request failed for userId=" << self->userId << ": " << e.what() << std::endl;
+            failed = true;
+        }
+
+        // 无论成败都要回到 strand 递减 dbInFlight_，否则该连接永远停止解析
+        self->runInStrand([self, respType, failed, done = std::move(done), result = std::move(result)]() mutable {
+            --self->dbInFlight_;
+            try
+            {
+                if (!failed)
+                    done(std::move(result));
+                else if (respType)
+                    self->send(json{{"type", respType}, {"success", false}, {"msg", "server error"}});
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "[ChatSession] db completion failed for userId=" << self->userId << ": " << e.what() << std::endl;
+            }
+            if (self->dbInFlight_ == 0)
+                self->handlePacket(); // 继续处理暂停期间积下的帧
+        });
+    });
+
+    if (!ok)
+    {
+        --dbInFlight_;
+        if (respType)
+            send(json{{"type", respType}, {"success", false}, {"msg", "server busy"}});
+        else
+            std::cerr << "[DbExecutor] queue full, request dropped for userId=" << userId << std::endl;
+    }
+    return ok;
+}
+
+template <typename Work>
+bool ChatSession::submitDb(const char *respType, Work work)
+{
+    return submitDb(respType, std::move(work), [this](json &&resp) { send(resp); });
+}
+
+void ChatSession::runInStrand(Task task)
 {
-    handlers["LOGIN"] = [this](const json &message)
-    { this->handleLogin(message); };
-    handlers["REGISTER"] = [this](const json &message)
-    { this->handleRegister(message); };
-    handlers["CHAT"] = [this](const json &message)
-    { this->handleChat(message); };
-    handlers["HEARTBEAT"] = [this](const json &message)
-    { this->handleHeartbeat(message); };
-    handlers["ADD_FRIEND"] = [this](const json &message)
-    { this->handleAddFriend(message); };
-    handlers["GET_FRIENDS"] = [this](const json &message)
-    { this->handleGetFriends(message); };
+    tasks_.push(std::move(task));
+    schedule();
 }
 
 // 细分业务组
@@ -220,54 +756,31 @@ void ChatSession::handleRegister(const json &message)
         return;
     }
 
-    auto conn = SqlConnPool::getInstance().getConn();
-    if (!conn) {
-        json resp = {{"type", "REGISTER_RESP"}, {"success", false}, {"msg", "database unavailable"}};
-        send(resp);
-        return;
-    }
-
-    // 防注入转义
-    char escapedUser[101], escapedPwd[129];
-    mysql_real_escape_string(conn.get(), escapedUser, user.c_str(), user.size());
-    mysql_real_escape_string(conn.get(), escapedPwd,  pwd.c_str(),  pwd.size());
+    submitDb("REGISTER_RESP", [user, pwd](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "REGISTER_RESP"}, {"success", false}, {"msg", "database unavailable"}};
 
-    // 检查用户名是否已存在
-    char sql[512];
-    snprintf(sql, sizeof(sql),
-             "SELECT id FROM User WHERE username='%s'", escapedUser);
+        // 检查用户名是否已存在
+        SqlStatement &exists = conn->stmt(StmtId::UserByName);
+        if (!exists.execute(user))
+            return {{"type", "REGISTER_RESP"}, {"success", false}, {"msg", "query error"}};
+        if (exists.fetch())
+            return {{"type", "REGISTER_RESP"}, {"success", false}, {"msg", "username already exists"}};
 
-    if (mysql_query(conn.get(), sql) != 0) {
-        json resp = {{"type", "REGISTER_RESP"}, {"success", false}, {"msg", "query error"}};
-        send(resp);
-        return;
-    }
+        // 插入新用户
+        SqlStatement &insert = conn->stmt(StmtId::UserInsert);
+        if (!insert.execute(user, pwd))
+            return {{"type", "REGISTER_RESP"}, {"success", false},
+                    {"msg", std::string("register failed: ") + insert.error()}};
 
-    MYSQL_RES* res = mysql_store_result(conn.get());
-    if (res && mysql_num_rows(res) > 0) {
-        mysql_free_result(res);
-        json resp = {{"type", "REGISTER_RESP"}, {"success", false}, {"msg", "username already exists"}};
-        send(resp);
-        return;
-    }
-    if (res) mysql_free_result(res);
+        int newUserId = static_cast<int>(insert.insertId());
+        std::cout << "[Register] user=" << user << " userId=" << newUserId << std::endl;
 
-    // 插入新用户
-    snprintf(sql, sizeof(sql),
-             "INSERT INTO User(username, password) VALUES('%s', '%s')", escapedUser, escapedPwd);
+        // 用户名对应的账号已变，丢弃可能残留的缓存条目
+        CredentialCache::getInstance().invalidate(user);
 
-    if (mysql_query(conn.get(), sql) != 0) {
-        json resp = {{"type", "REGISTER_RESP"}, {"success", false},
-                     {"msg", std::string("register failed: ") + mysql_error(conn.get())}};
-        send(resp);
-        return;
-    }
-
-    int newUserId = static_cast<int>(mysql_insert_id(conn.get()));
-    std::cout << "[Register] user=" << user << " userId=" << newUserId << std::endl;
-
-    json resp = {{"type", "REGISTER_RESP"}, {"success", true}, {"userId", newUserId}, {"msg", "register success"}};
-    send(resp);
+        return {{"type", "REGISTER_RESP"}, {"success", true}, {"userId", newUserId}, {"msg", "register success"}};
+    });
 }
 
 // ─── 登录（数据库校验） ──────────────────────────────────────────────────────
@@ -288,59 +801,127 @@ void ChatSession::handleLogin(const json &message)
         return;
     }
 
-    auto conn = SqlConnPool::getInstance().getConn();
-    if (!conn) {
-        json resp = {{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "database unavailable"}};
-        send(resp);
+    // 协商线上格式："format" 字段优先，缺省沿用 LOGIN 帧自身的编码；回执起即使用新格式
+    WireFormat format = inFormat_;
+    auto formatIt = message.find("format");
+    if (formatIt != message.end() && formatIt->is_string())
+        codec::formatFromName(formatIt->get_ref<const std::string &>(), format);
+
+    // 先查凭据缓存：命中时好友列表在线上已有则整个登录不碰数据库，否则只查好友 id
+    CredentialCache &cache = CredentialCache::getInstance();
+    CredentialCache::Digest digest = cache.digest(user, pwd);
+    if (std::optional<CredentialCache::Profile> profile = cache.lookup(user, digest)) {
+        json resp = {{"type", "LOGIN_RESP"}, {"success", true},
+                     {"userId", profile->userId}, {"nickname", profile->nickname}, {"msg", "login success"}};
+        resp["friendStamp"] = FriendCache::getInstance().stamp(profile->userId);
+        if (FriendCache::List friends = FriendCache::getInstance().get(profile->userId)) {
+            resp["friends"] = *friends;
+            completeLogin(std::move(resp), user, format);
+            return;
+        }
+        submitDb("LOGIN_RESP", [resp = std::move(resp)](SqlConn *conn) mutable -> json {
+            if (!conn)
+                return {{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+            int id = resp["userId"].get<int>();
+            resp["friendStamp"] = FriendCache::getInstance().stamp(id);
+            resp["friends"] = loadFriendIds(conn, id);
+            return std::move(resp);
+        },
+        [this, user, format](json &&resp) { completeLogin(std::move(resp), user, format); });
         return;
     }
 
-    // 防注入转义
-    char escapedUser[101], escapedPwd[129];
-    mysql_real_escape_string(conn.get(), escapedUser, user.c_str(), user.size());
-    mysql_real_escape_string(conn.get(), escapedPwd,  pwd.c_str(),  pwd.size());
-
-    char sql[512];
-    snprintf(sql, sizeof(sql),
-             "SELECT id, nickname FROM User WHERE username='%s' AND password='%s'",
-             escapedUser, escapedPwd);
-
-    if (mysql_query(conn.get(), sql) != 0) {
-        json resp = {{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "query error"}};
-        send(resp);
+    // 未命中：同一组凭据已有在途查询时搭车等结果，期间同样暂停解析后续帧
+    auto self = shared_from_this();
+    bool leader = cache.join(user, digest, [self, user, format](const json &resp) {
+        self->runInStrand([self, user, format, resp = json(resp)]() mutable {
+            --self->dbInFlight_;
+            self->completeLogin(std::move(resp), user, format);
+            if (self->dbInFlight_ == 0)
+                self->handlePacket();
+        });
+    });
+    if (!leader) {
+        ++dbInFlight_;
         return;
     }
 
-    MYSQL_RES* res = mysql_store_result(conn.get());
-    if (!res || mysql_num_rows(res) == 0) {
-        if (res) mysql_free_result(res);
-        json resp = {{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "wrong username or password"}};
+    // leader 的每条返回路径都要 complete，否则搭车的会话永远等不到结果
+    bool queued = submitDb("LOGIN_RESP", [user, pwd, digest](SqlConn *conn) -> json {
+        CredentialCache &cache = CredentialCache::getInstance();
+        try {
+            json resp = verifyLogin(conn, user, pwd);
+            if (resp["success"].get<bool>())
+                cache.insert(user, digest, {resp["userId"].get<int>(), resp["nickname"].get<std::string>()});
+            cache.complete(user, digest, resp);
+            return resp;
+        } catch (...) {
+            cache.complete(user, digest, json{{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "server error"}});
+            throw;
+        }
+    },
+    [this, user, format](json &&resp) { completeLogin(std::move(resp), user, format); });
+    if (!queued)
+        cache.complete(user, digest, json{{"type", "LOGIN_RESP"}, {"success", false}, {"msg", "server busy"}});
+}
+
+// 登录结果回到 strand：失败直接回执；成功则登记会话并下发初始状态
+void ChatSession::completeLogin(json &&resp, const std::string &user, WireFormat format)
+{
+    if (!resp["success"].get<bool>()) {
         send(resp);
         return;
     }
 
-    MYSQL_ROW row = mysql_fetch_row(res);
-    int dbUserId = std::stoi(row[0]);
-    std::string nickname = row[1] ? row[1] : user;
-    mysql_free_result(res);
+    format_.store(format, std::memory_order_relaxed);
+
+    std::vector<int> friendIds = resp["friends"].get<std::vector<int>>();
+    uint64_t friendStamp = resp["friendStamp"].get<uint64_t>();
+    resp.erase("friends");
+    resp.erase("friendStamp");
 
     // 状态变更
-    userId    = dbUserId;
+    userId    = resp["userId"].get<int>();
     username_ = user;
     isLogin   = true;
 
-    // 注册映射
+    // 好友列表先于映射登记，上线推送发布时必然能取到；读取后有并发加好友时重新加载补齐
+    if (!FriendCache::getInstance().acquire(userId, friendIds, friendStamp)) {
+        int selfId = userId;
+        submitDb(nullptr, [selfId](SqlConn *conn) -> json {
+            if (conn)
+                FriendCache::getInstance().merge(selfId, loadFriendIds(conn, selfId).get<std::vector<int>>());
+            return nullptr;
+        },
+        [](json &&) {});
+    }
+    FriendCache::getInstance().setProfile(userId, user, resp["nickname"].get<std::string>());
     UserManager::getInstance().addSession(userId, shared_from_this());
 
     std::cout << "[Login] user=" << user << " userId=" << userId << std::endl;
 
     // 回执给客户端
-    json resp = {{"type", "LOGIN_RESP"}, {"success", true},
-                 {"userId", userId}, {"nickname", nickname}, {"msg", "login success"}};
+    resp["format"] = codec::formatName(format);
     send(resp);
 
-    // 登录成功后拉取离线消息
-    pullOfflineMessages();
+    // 好友在线状态的初始快照（已发布的状态），之后只推送变化
+    std::vector<uint8_t> online = PresenceNotifier::getInstance().announcedMask(friendIds);
+    json onlineIds = json::array();
+    for (size_t i = 0; i < friendIds.size(); ++i)
+        if (online[i])
+            onlineIds.push_back(friendIds[i]);
+    send(json{{"type", "PRESENCE"}, {"online", std::move(onlineIds)}});
+
+    // 登录成功后拉取离线消息与频道游标之后的消息；
+    // 离线消息等写入队列里已有的消息落库后再拉，下线前刚发来的消息不会漏掉
+    offlineCursor_ = offlineAcked_ = 0;
+    auto self = shared_from_this();
+    bool queued = OfflineWriter::getInstance().barrier([self](size_t) {
+        self->runInStrand([self] { self->pullOfflinePage(); });
+    });
+    if (!queued)
+        pullOfflinePage();
+    syncChannels();
 }
 
 void ChatSession::handleChat(const json &message)
@@ -364,25 +945,22 @@ void ChatSession::handleChat(const json &message)
     // 构造转发消息，附上发送者 ID
     json forwardMsg = {
         {"type",    "CHAT"},
-        {"from",    userId},
+        {"from",    userId.load()},
         {"to",      toId},
         {"content", content}
     };
 
     bool ok = UserManager::getInstance().sendTo(toId, forwardMsg);
     if (!ok) {
-        // 目标不在线，存入离线消息表
-        storeOfflineMessage(toId, userId, forwardMsg.dump());
-
-        json notify = {{"type", "SYSTEM"}, {"msg", "user " + std::to_string(toId) + " is offline, message saved"}};
-        send(notify);
+        // 目标不在线，存入离线消息表（完成后回执）
+        storeOfflineMessage(toId, userId, codec::toText(forwardMsg));
     }
 }
 
 void ChatSession::handleHeartbeat(const json &message)
 {
-    // 更新活跃时间，保持连接存活
-    lastActiveTime = time(nullptr);
+    // 更新活跃时间，保持连接存活（时间轮到期时据此顺延）
+    lastActiveTime.store(CoarseClock::now(), std::memory_order_relaxed);
 }
 
 // ─── 添加好友 ────────────────────────────────────────────────────────────────
@@ -407,183 +985,624 @@ void ChatSession::handleAddFriend(const json &message)
         return;
     }
 
-    auto conn = SqlConnPool::getInstance().getConn();
-    if (!conn) {
-        json resp = {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "database unavailable"}};
-        send(resp);
-        return;
+    // 重复检查只看本地好友关系图：自己已登录，这一行常驻且由 link 维护
+    int selfId = userId;
+    FriendCache &cache = FriendCache::getInstance();
+    if (FriendCache::List mine = cache.get(selfId)) {
+        if (std::binary_search(mine->begin(), mine->end(), friendId)) {
+            json resp = {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "already friends"}};
+            send(resp);
+            return;
+        }
     }
 
-    // 检查目标用户是否存在
-    char sql[512];
-    snprintf(sql, sizeof(sql), "SELECT id FROM User WHERE id=%d", friendId);
+    // 缓存里有这个用户就不必再查 User 表（用户不会被删除）
+    bool known = cache.known(friendId);
+    submitDb("ADD_FRIEND_RESP", [selfId, friendId, known](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+
+        // 检查目标用户是否存在，顺带缓存资料
+        if (!known) {
+            SqlStatement &user = conn->stmt(StmtId::UserById);
+            if (!user.execute(friendId))
+                return {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "query error"}};
+            if (!user.fetch())
+                return {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "user not found"}};
+            std::string username = user.getString(1);
+            std::string nickname = user.isNull(2) ? username : user.getString(2);
+            FriendCache::getInstance().setProfile(friendId, std::move(username), std::move(nickname));
+        }
 
-    if (mysql_query(conn.get(), sql) != 0) {
-        json resp = {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "query error"}};
+        // 双向插入好友关系；并发添加时由主键去重
+        SqlStatement &insert = conn->stmt(StmtId::FriendInsert);
+        if (!insert.execute(selfId, friendId, friendId, selfId))
+            return {{"type", "ADD_FRIEND_RESP"}, {"success", false},
+                    {"msg", std::string("add friend failed: ") + insert.error()}};
+        if (insert.affectedRows() == 0)
+            return {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "already friends"}};
+
+        return {{"type", "ADD_FRIEND_RESP"}, {"success", true}, {"friendId", friendId}};
+    },
+    [this, selfId, friendId](json &&resp) {
+        bool ok = resp["success"].get<bool>();
+        send(resp);
+        if (!ok)
+            return;
+
+        // 先补边：此后发布的上下线都会推给对方；已发布为在线的一方这里直接补发
+        FriendCache::getInstance().link(selfId, friendId);
+        PresenceNotifier& notifier = PresenceNotifier::getInstance();
+        if (notifier.isAnnounced(selfId))
+            UserManager::getInstance().sendTo(friendId, json{{"type", "PRESENCE"}, {"online", json::array({selfId})}});
+        if (notifier.isAnnounced(friendId))
+            send(json{{"type", "PRESENCE"}, {"online", json::array({friendId})}});
+    });
+}
+
+// ─── 获取好友列表 ────────────────────────────────────────────────────────────
+void ChatSession::handleGetFriends(const json &message)
+{
+    if (!isLogin) {
+        json resp = {{"type", "SYSTEM"}, {"msg", "please login first"}};
         send(resp);
         return;
     }
 
-    MYSQL_RES* checkRes = mysql_store_result(conn.get());
-    if (!checkRes || mysql_num_rows(checkRes) == 0) {
-        if (checkRes) mysql_free_result(checkRes);
-        json resp = {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "user not found"}};
-        send(resp);
+    // 好友 id 与资料都在缓存中时直接回复，否则查一次库并顺带补齐资料
+    int selfId = userId;
+    FriendCache &cache = FriendCache::getInstance();
+    std::vector<FriendCache::Profile> profiles;
+    FriendCache::List ids = cache.get(selfId);
+    if (ids && cache.profiles(*ids, profiles)) {
+        json friends = json::array();
+        for (size_t i = 0; i < ids->size(); ++i)
+            friends.push_back({{"id", (*ids)[i]}, {"username", std::move(profiles[i].username)},
+                               {"nickname", std::move(profiles[i].nickname)}});
+        markOnline(friends);
+        send(json{{"type", "GET_FRIENDS_RESP"}, {"success", true}, {"friends", std::move(friends)}});
         return;
     }
-    mysql_free_result(checkRes);
 
-    // 检查是否已是好友
-    snprintf(sql, sizeof(sql),
-             "SELECT userid FROM Friend WHERE userid=%d AND friendid=%d", userId, friendId);
-    if (mysql_query(conn.get(), sql) == 0) {
-        MYSQL_RES* res = mysql_store_result(conn.get());
-        if (res && mysql_num_rows(res) > 0) {
-            mysql_free_result(res);
-            json resp = {{"type", "ADD_FRIEND_RESP"}, {"success", false}, {"msg", "already friends"}};
-            send(resp);
-            return;
+    submitDb("GET_FRIENDS_RESP", [selfId](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "GET_FRIENDS_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+
+        SqlStatement &list = conn->stmt(StmtId::FriendList);
+        if (!list.execute(selfId))
+            return {{"type", "GET_FRIENDS_RESP"}, {"success", false}, {"msg", "query error"}};
+
+        FriendCache &cache = FriendCache::getInstance();
+        json friends = json::array();
+        while (list.fetch()) {
+            int id = list.getInt(0);
+            std::string username = list.getString(1);
+            std::string nickname = list.isNull(2) ? username : list.getString(2);
+            cache.setProfile(id, username, nickname);
+
+            json f;
+            f["id"]       = id;
+            f["username"] = std::move(username);
+            f["nickname"] = std::move(nickname);
+            friends.push_back(f);
         }
-        if (res) mysql_free_result(res);
-    }
 
-    // 双向插入好友关系
-    snprintf(sql, sizeof(sql),
-             "INSERT INTO Friend(userid, friendid) VALUES(%d, %d), (%d, %d)",
-             userId, friendId, friendId, userId);
+        return {{"type", "GET_FRIENDS_RESP"}, {"success", true}, {"friends", friends}};
+    },
+    [this](json &&resp) {
+        if (resp["success"].get<bool>())
+            markOnline(resp["friends"]);
+        send(resp);
+    });
+}
 
-    if (mysql_query(conn.get(), sql) != 0) {
-        json resp = {{"type", "ADD_FRIEND_RESP"}, {"success", false},
-                     {"msg", std::string("add friend failed: ") + mysql_error(conn.get())}};
+// ─── 群组：创建 / 加入 / 退出 ────────────────────────────────────────────────
+void ChatSession::handleGroupCreate(const json &message)
+{
+    if (!message.contains("name") || !message["name"].is_string() || message["name"].get_ref<const std::string &>().empty()) {
+        json resp = {{"type", "GROUP_CREATE_RESP"}, {"success", false}, {"msg", "missing name"}};
         send(resp);
         return;
     }
 
-    json resp = {{"type", "ADD_FRIEND_RESP"}, {"success", true}, {"friendId", friendId}};
-    send(resp);
+    std::string name = message["name"];
+    bool channel = message.value("channel", false);
+    int selfId = userId;
+    submitDb("GROUP_CREATE_RESP", [selfId, name, channel](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "GROUP_CREATE_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+
+        SqlStatement &insert = conn->stmt(StmtId::GroupInsert);
+        if (!insert.execute(std::string_view(name).substr(0, 50), selfId, channel ? 1 : 0))
+            return {{"type", "GROUP_CREATE_RESP"}, {"success", false},
+                    {"msg", std::string("create group failed: ") + insert.error()}};
+
+        int groupId = static_cast<int>(insert.insertId());
+        SqlStatement &member = conn->stmt(StmtId::GroupMemberAdd);
+        if (!member.execute(groupId, selfId))
+            return {{"type", "GROUP_CREATE_RESP"}, {"success", false},
+                    {"msg", std::string("create group failed: ") + member.error()}};
+
+        return {{"type", "GROUP_CREATE_RESP"}, {"success", true}, {"groupId", groupId}, {"name", name},
+                {"channel", channel}};
+    },
+    [this, selfId, channel](json &&resp) {
+        // 新群只有创建者一人，直接写入缓存，第一条群消息无需再查库
+        if (resp["success"].get<bool>()) {
+            int groupId = resp["groupId"].get<int>();
+            GroupCache& cache = GroupCache::getInstance();
+            cache.put(groupId, GroupCache::Group{channel, {selfId}}, cache.stamp(groupId));
+            if (channel)
+                channelCursors_[groupId] = ChannelCursor{0, 0, true};
+        }
+        send(resp);
+    });
 }
 
-// ─── 获取好友列表 ────────────────────────────────────────────────────────────
-void ChatSession::handleGetFriends(const json &message)
+void ChatSession::handleGroupJoin(const json &message)
 {
-    if (!isLogin) {
-        json resp = {{"type", "SYSTEM"}, {"msg", "please login first"}};
+    if (!message.contains("groupId")) {
+        json resp = {{"type", "GROUP_JOIN_RESP"}, {"success", false}, {"msg", "missing groupId"}};
         send(resp);
         return;
     }
 
-    auto conn = SqlConnPool::getInstance().getConn();
-    if (!conn) {
-        json resp = {{"type", "GET_FRIENDS_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+    int groupId = message["groupId"];
+    int selfId  = userId;
+    submitDb("GROUP_JOIN_RESP", [selfId, groupId](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "GROUP_JOIN_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+
+        SqlStatement &kind = conn->stmt(StmtId::GroupKind);
+        if (!kind.execute(groupId))
+            return {{"type", "GROUP_JOIN_RESP"}, {"success", false}, {"msg", "query error"}};
+        if (!kind.fetch())
+            return {{"type", "GROUP_JOIN_RESP"}, {"success", false}, {"msg", "group not found"}};
+        bool channel = kind.getInt(0) == 1;
+
+        SqlStatement &member = conn->stmt(StmtId::GroupMemberAdd);
+        if (!member.execute(groupId, selfId))
+            return {{"type", "GROUP_JOIN_RESP"}, {"success", false},
+                    {"msg", std::string("join group failed: ") + member.error()}};
+        if (member.affectedRows() == 0)
+            return {{"type", "GROUP_JOIN_RESP"}, {"success", false}, {"msg", "already a member"}};
+
+        return {{"type", "GROUP_JOIN_RESP"}, {"success", true}, {"groupId", groupId}, {"channel", channel}};
+    },
+    [this, selfId, groupId](json &&resp) {
+        if (resp["success"].get<bool>()) {
+            GroupCache::getInstance().addMember(groupId, selfId);
+            // 新成员的游标从头开始，历史消息用 CHANNEL_PULL 分页拉取
+            if (resp["channel"].get<bool>())
+                channelCursors_[groupId] = ChannelCursor{0, 0, false};
+        }
+        send(resp);
+    });
+}
+
+void ChatSession::handleGroupLeave(const json &message)
+{
+    if (!message.contains("groupId")) {
+        json resp = {{"type", "GROUP_LEAVE_RESP"}, {"success", false}, {"msg", "missing groupId"}};
         send(resp);
         return;
     }
 
-    char sql[512];
-    snprintf(sql, sizeof(sql),
-             "SELECT u.id, u.username, u.nickname FROM Friend f "
-             "JOIN User u ON f.friendid = u.id WHERE f.userid = %d", userId);
+    int groupId = message["groupId"];
+    int selfId  = userId;
+    submitDb("GROUP_LEAVE_RESP", [selfId, groupId](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "GROUP_LEAVE_RESP"}, {"success", false}, {"msg", "database unavailable"}};
+
+        SqlStatement &member = conn->stmt(StmtId::GroupMemberDelete);
+        if (!member.execute(groupId, selfId))
+            return {{"type", "GROUP_LEAVE_RESP"}, {"success", false},
+                    {"msg", std::string("leave group failed: ") + member.error()}};
+        if (member.affectedRows() == 0)
+            return {{"type", "GROUP_LEAVE_RESP"}, {"success", false}, {"msg", "not a member"}};
+
+        return {{"type", "GROUP_LEAVE_RESP"}, {"success", true}, {"groupId", groupId}};
+    },
+    [this, selfId, groupId](json &&resp) {
+        if (resp["success"].get<bool>()) {
+            GroupCache::getInstance().removeMember(groupId, selfId);
+            channelCursors_.erase(groupId);
+        }
+        send(resp);
+    });
+}
 
-    if (mysql_query(conn.get(), sql) != 0) {
-        json resp = {{"type", "GET_FRIENDS_RESP"}, {"success", false}, {"msg", "query error"}};
+// ─── 群聊 ────────────────────────────────────────────────────────────────────
+void ChatSession::handleGroupChat(const json &message)
+{
+    if (!message.contains("groupId") || !message.contains("content")) {
+        json resp = {{"type", "SYSTEM"}, {"msg", "missing groupId or content"}};
         send(resp);
         return;
     }
 
-    MYSQL_RES* res = mysql_store_result(conn.get());
-    json friends = json::array();
-    if (res) {
-        MYSQL_ROW row;
-        while ((row = mysql_fetch_row(res)) != nullptr) {
-            json f;
-            f["id"]       = std::stoi(row[0]);
-            f["username"] = row[1] ? row[1] : "";
-            f["nickname"] = row[2] ? row[2] : "";
-            friends.push_back(f);
-        }
-        mysql_free_result(res);
+    int groupId         = message["groupId"];
+    std::string content = message["content"];
+
+    // 热路径：成员表命中缓存，不访问数据库
+    if (GroupCache::GroupPtr group = GroupCache::getInstance().get(groupId)) {
+        postGroupMessage(groupId, content, group);
+        return;
     }
 
-    // 用 getOnlineUsers 批量查询在线状态
-    auto onlineUsers = UserManager::getInstance().getOnlineUsers();
-    std::unordered_set<int> onlineSet(onlineUsers.begin(), onlineUsers.end());
-    for (auto& f : friends) {
-        f["online"] = onlineSet.count(f["id"].get<int>()) > 0;
+    // 未命中：加载成员表，完成前暂停本连接后续帧，消息顺序不变
+    uint64_t stamp = GroupCache::getInstance().stamp(groupId);
+    submitDb("SYSTEM", [groupId](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "SYSTEM"}, {"msg", "database unavailable"}};
+
+        SqlStatement &kind = conn->stmt(StmtId::GroupKind);
+        if (!kind.execute(groupId))
+            return {{"type", "SYSTEM"}, {"msg", "query error"}};
+        bool channel = kind.fetch() && kind.getInt(0) == 1;
+
+        SqlStatement &list = conn->stmt(StmtId::GroupMembers);
+        if (!list.execute(groupId))
+            return {{"type", "SYSTEM"}, {"msg", "query error"}};
+
+        json members = json::array();
+        while (list.fetch())
+            members.push_back(list.getInt(0));
+        return {{"channel", channel}, {"members", std::move(members)}};
+    },
+    [this, groupId, content, stamp](json &&resp) {
+        auto it = resp.find("members");
+        if (it == resp.end()) {
+            send(resp);
+            return;
+        }
+
+        std::vector<int> ids = it->get<std::vector<int>>();
+        if (ids.empty()) {
+            // 不存在的群不入缓存，避免任意 groupId 撑大缓存
+            send(json{{"type", "SYSTEM"}, {"msg", "not a member of group " + std::to_string(groupId)}});
+            return;
+        }
+        bool channel = resp["channel"].get<bool>();
+        GroupCache::GroupPtr group = GroupCache::getInstance().put(groupId, GroupCache::Group{channel, std::move(ids)}, stamp);
+        postGroupMessage(groupId, content, group);
+    });
+}
+
+void ChatSession::postGroupMessage(int groupId, const std::string &content, const GroupCache::GroupPtr &group)
+{
+    if (!std::binary_search(group->members.begin(), group->members.end(), userId.load())) {
+        send(json{{"type", "SYSTEM"}, {"msg", "not a member of group " + std::to_string(groupId)}});
+        return;
     }
 
-    json resp = {{"type", "GET_FRIENDS_RESP"}, {"success", true}, {"friends", friends}};
-    send(resp);
+    if (group->channel)
+        postChannelMessage(groupId, content, group);
+    else
+        fanOutGroupMessage(groupId, content, group->members);
 }
 
-// ─── 离线消息：拉取 ──────────────────────────────────────────────────────────
-void ChatSession::pullOfflineMessages()
+// ─── 频道：只追加一次日志，在线成员实时推送，其余成员按游标拉取 ───────────────
+void ChatSession::postChannelMessage(int groupId, const std::string &content, const GroupCache::GroupPtr &group)
 {
-    auto conn = SqlConnPool::getInstance().getConn();
-    if (!conn) return;
+    int selfId = userId;
+
+    // 推送在写入成功后直接在 DB 线程完成，不依赖发帖者的 Session 是否还在；
+    // 在途登记随任务一起销毁（排队被拒、写入失败、抛异常），不会让频道水位停住
+    submitDb("SYSTEM", [groupId, selfId, content, group, post = ChannelLog::Post(groupId)](SqlConn *conn) mutable -> json {
+        if (!conn) {
+            return {{"type", "SYSTEM"}, {"msg", "database unavailable"}};
+        }
 
-    char sql[512];
-    snprintf(sql, sizeof(sql),
-             "SELECT id, content FROM OfflineMessage WHERE to_userid=%d ORDER BY send_time ASC",
-             userId);
+        SqlStatement &insert = conn->stmt(StmtId::ChannelInsert);
+        if (!insert.execute(groupId, selfId, content)) {
+            std::cerr << "[Channel] post error: " << insert.error() << std::endl;
+            return {{"type", "SYSTEM"}, {"msg", "failed to post to channel " + std::to_string(groupId)}};
+        }
+        int64_t msgId = static_cast<int64_t>(insert.insertId());
+
+        std::vector<int> targets;
+        targets.reserve(group->members.size());
+        for (int id : group->members)
+            if (id != selfId)
+                targets.push_back(id);
+
+        // 不在线的成员什么也不写，登录时从游标处拉取
+        FramePtr frame = Frame::make(json{
+            {"type",    "GROUP_CHAT"},
+            {"groupId", groupId},
+            {"from",    selfId},
+            {"content", content},
+            {"msgId",   msgId}
+        });
+        UserManager::getInstance().sendToMany(targets, frame);
+        post.finish(msgId);
+        return {{"msgId", msgId}};
+    },
+    [this](json &&resp) {
+        if (!resp.contains("msgId"))
+            send(resp);
+    });
+}
 
-    if (mysql_query(conn.get(), sql) != 0) {
-        std::cerr << "[OfflineMsg] query error: " << mysql_error(conn.get()) << std::endl;
+void ChatSession::syncChannels()
+{
+    int selfId = userId;
+    submitDb(nullptr, [selfId](SqlConn *conn) -> json {
+        json pages = json::array();
+        if (!conn) return pages;
+
+        SqlStatement &channels = conn->stmt(StmtId::ChannelCursors);
+        if (!channels.execute(selfId)) {
+            std::cerr << "[Channel] sync error: " << channels.error() << std::endl;
+            return pages;
+        }
+
+        std::vector<std::pair<int, int64_t>> cursors;
+        while (channels.fetch())
+            cursors.emplace_back(channels.getInt(0), channels.getInt64(1));
+
+        for (const auto& [groupId, cursor] : cursors)
+            pages.push_back(pullChannelPage(conn, groupId, cursor));
+        return pages;
+    },
+    [this](json &&pages) {
+        for (json &page : pages)
+            applyChannelPage(page, false);
+    });
+}
+
+void ChatSession::handleChannelPull(const json &message)
+{
+    if (!message.contains("groupId")) {
+        json resp = {{"type", "SYSTEM"}, {"msg", "missing groupId"}};
+        send(resp);
         return;
     }
 
-    MYSQL_RES* res = mysql_store_result(conn.get());
-    if (!res) return;
+    int groupId = message["groupId"];
+    auto it = channelCursors_.find(groupId);
+    if (it == channelCursors_.end()) {
+        send(json{{"type", "SYSTEM"}, {"msg", "not a member of channel " + std::to_string(groupId)}});
+        return;
+    }
 
-    std::vector<int> idsToDelete;
+    int64_t cursor = it->second.cursor;
+    submitDb("SYSTEM", [groupId, cursor](SqlConn *conn) -> json {
+        if (!conn)
+            return {{"type", "SYSTEM"}, {"msg", "database unavailable"}};
+        return pullChannelPage(conn, groupId, cursor);
+    },
+    [this](json &&page) {
+        if (!page.contains("messages")) {
+            send(page);
+            return;
+        }
+        applyChannelPage(page, true);
+    });
+}
 
-    MYSQL_ROW row;
-    while ((row = mysql_fetch_row(res)) != nullptr) {
-        int msgId = std::stoi(row[0]);
-        std::string content = row[1];
+void ChatSession::applyChannelPage(json &page, bool always)
+{
+    int groupId    = page["groupId"].get<int>();
+    int64_t cursor = page["cursor"].get<int64_t>();
+    bool more      = page["more"].get<bool>();
+    json &messages = page["messages"];
+
+    // 取完最后一页才算追上；此后在线期间靠实时推送，下线时游标可推进到稳定水位。
+    // 库里的游标仍停在首次拉取前的位置，直到下线时确认这些帧已经写出
+    auto it = channelCursors_.find(groupId);
+    int64_t stored = it != channelCursors_.end() ? it->second.stored : page["after"].get<int64_t>();
+    channelCursors_[groupId] = ChannelCursor{cursor, stored, !more};
+
+    for (const json &msg : messages)
+        send(msg);
+    if (always || more || !messages.empty())
+        send(json{{"type", "CHANNEL_SYNC"}, {"groupId", groupId}, {"cursor", cursor}, {"more", more}});
+}
 
-        try {
-            json msg = json::parse(content);
-            send(msg);
-            idsToDelete.push_back(msgId);
-        } catch (const std::exception& e) {
-            std::cerr << "[OfflineMsg] parse error for id=" << msgId << std::endl;
-            idsToDelete.push_back(msgId); // 解析失败也删除，避免反复推送坏数据
-        }
+void ChatSession::persistChannelCursors()
+{
+    // 稳定水位之内的推送都已进入 inbox 或发送队列；只有两者都已写空，才说明它们确实写进了 socket。
+    // 超过硬上限、断网时仍有积压等非正常关闭不推进，下次登录从原游标重新拉取
+    if (pendingOutput() != 0 || !inbox_.empty()) {
+        channelCursors_.clear();
+        return;
     }
-    mysql_free_result(res);
 
-    // 批量删除已发送的离线消息
-    for (int id : idsToDelete) {
-        snprintf(sql, sizeof(sql), "DELETE FROM OfflineMessage WHERE id=%d", id);
-        mysql_query(conn.get(), sql);
+    // 已拉取的页推进到页末，已追上的频道推进到稳定水位（频道数不定，拼成一条 CASE UPDATE 按文本执行）
+    std::string cases, ids;
+    for (const auto& [groupId, state] : channelCursors_) {
+        int64_t target = state.cursor;
+        if (state.caughtUp)
+            target = std::max(target, ChannelLog::getInstance().stableHead(groupId));
+        if (target <= state.stored)
+            continue;
+        cases += " WHEN " + std::to_string(groupId) + " THEN " + std::to_string(target);
+        ids   += (ids.empty() ? "" : ",") + std::to_string(groupId);
     }
+    channelCursors_.clear();
+    if (ids.empty())
+        return;
 
-    if (!idsToDelete.empty()) {
-        std::cout << "[OfflineMsg] Delivered " << idsToDelete.size()
-                  << " offline messages to userId=" << userId << std::endl;
-    }
+    std::string sql = "UPDATE GroupMember SET read_cursor=GREATEST(read_cursor, CASE groupid" + cases +
+                      " END) WHERE userid=" + std::to_string(userId.load()) + " AND groupid IN (" + ids + ")";
+    bool ok = DbExecutor::getInstance().submit([sql = std::move(sql)] {
+        auto conn = SqlConnPool::getInstance().getConn();
+        if (conn && mysql_real_query(conn->mysql(), sql.data(), sql.size()) != 0)
+            std::cerr << "[Channel] cursor persist error: " << mysql_error(conn->mysql()) << std::endl;
+    });
+    if (!ok)
+        std::cerr << "[DbExecutor] queue full, channel cursors not saved for userId=" << userId << std::endl;
 }
 
-// ─── 离线消息：存储 ──────────────────────────────────────────────────────────
-void ChatSession::storeOfflineMessage(int toId, int fromId, const std::string& content)
+void ChatSession::fanOutGroupMessage(int groupId, const std::string &content, const std::vector<int> &members)
 {
-    auto conn = SqlConnPool::getInstance().getConn();
-    if (!conn) {
-        std::cerr << "[OfflineMsg] Cannot store: database unavailable" << std::endl;
+    int selfId = userId;
+    std::vector<int> targets;
+    targets.reserve(members.size() - 1);
+    for (int id : members)
+        if (id != selfId)
+            targets.push_back(id);
+    if (targets.empty())
         return;
-    }
 
-    // 转义消息内容，防止 SQL 注入
-    std::string escaped(content.size() * 2 + 1, '\0');
-    mysql_real_escape_string(conn.get(), &escaped[0], content.c_str(), content.size());
-    escaped.resize(strlen(escaped.c_str()));
+    // 整条消息只编码一次，在线成员按分片分组投递，共享同一份字节
+    FramePtr frame = Frame::make(json{
+        {"type",    "GROUP_CHAT"},
+        {"groupId", groupId},
+        {"from",    selfId},
+        {"content", content}
+    });
+    std::vector<int> offline = UserManager::getInstance().sendToMany(targets, frame);
+
+    // 不在线的成员合并成一次批量写入
+    if (!offline.empty())
+        storeOfflineMessages(std::move(offline), selfId, codec::toText(frame->message()));
+}
+
+// ─── 离线消息：分页拉取 ──────────────────────────────────────────────────────
+// 按 id 游标每次取一页，发出后等发送队列降到低水位再取下一页；每页后发一帧
+// OFFLINE_SYNC（lastId、more）。行在客户端用 OFFLINE_ACK 确认后才删除，
+// 连接中途断开时未确认的消息下次登录重新下发，客户端按 offlineId 去重。
+void ChatSession::pullOfflinePage()
+{
+    int selfId = userId;
+    int64_t cursor = offlineCursor_;
+    submitDb(nullptr, [selfId, cursor](SqlConn *conn) -> json {
+        if (!conn)
+            return nullptr;
+
+        SqlStatement &page = conn->stmt(StmtId::OfflinePage);
+        if (!page.execute(selfId, static_cast<long long>(cursor), static_cast<long long>(kOfflinePageSize + 1))) {
+            std::cerr << "[OfflineMsg] query error: " << page.error() << std::endl;
+            return nullptr;
+        }
+
+        json messages = json::array();
+        int64_t last = cursor;
+        bool more = false;
+        while (page.fetch()) {
+            if (messages.size() == kOfflinePageSize) {
+                more = true; // 多取的一行只用来判断是否还有下一页
+                continue;
+            }
+            last = page.getInt64(0);
+            try {
+                json msg = json::parse(page.getString(1));
+                msg["offlineId"] = last;
+                messages.push_back(std::move(msg));
+            } catch (const std::exception& e) {
+                // 坏数据不下发，游标照常越过，随下一次确认一并删除
+                std::cerr << "[OfflineMsg] parse error for id=" << last << std::endl;
+            }
+        }
+        return {{"lastId", last}, {"more", more}, {"messages", std::move(messages)}};
+    },
+    [this, cursor](json &&page) {
+        if (page.is_null())
+            return;
+
+        int64_t last = page["lastId"].get<int64_t>();
+        bool more    = page["more"].get<bool>();
+        json &messages = page["messages"];
+        if (last == cursor)
+            return; // 没有离线消息
+
+        for (const json &msg : messages)
+            send(msg);
+        send(json{{"type", "OFFLINE_SYNC"}, {"lastId", last}, {"more", more}});
+        offlineCursor_ = last;
+
+        std::cout << "[OfflineMsg] Delivered " << messages.size()
+                  << " offline messages to userId=" << userId << (more ? " (more)" : "") << std::endl;
+
+        // 本轮 strand 结束时由 finishEvents 检查积压，降到低水位即取下一页
+        if (more)
+            offlineWaitDrain_.store(true, std::memory_order_relaxed);
+    });
+}
 
-    char sql[4096];
-    snprintf(sql, sizeof(sql),
-             "INSERT INTO OfflineMessage(to_userid, from_userid, content) VALUES(%d, %d, '%s')",
-             toId, fromId, escaped.c_str());
+void ChatSession::resumeOfflinePull()
+{
+    if (!offlineWaitDrain_.load(std::memory_order_relaxed) || !offlineWaitDrain_.exchange(false))
+        return;
+    auto self = shared_from_this();
+    runInStrand([self] { self->pullOfflinePage(); });
+}
 
-    if (mysql_query(conn.get(), sql) != 0) {
-        std::cerr << "[OfflineMsg] store error: " << mysql_error(conn.get()) << std::endl;
+// ─── 离线消息：确认 ──────────────────────────────────────────────────────────
+// {"type":"OFFLINE_ACK","msgId":N}：N 及之前已下发的离线消息一次范围删除
+void ChatSession::handleOfflineAck(const json &message)
+{
+    auto it = message.find("msgId");
+    if (it == message.end() || !it->is_number_integer()) {
+        send(json{{"type", "SYSTEM"}, {"msg", "missing msgId"}});
+        return;
     }
-}
\ No newline at end of file
+
+    // 只能确认已经下发过的部分
+    int64_t ackId = std::min(it->get<int64_t>(), offlineCursor_);
+    if (ackId <= offlineAcked_)
+        return;
+
+    int64_t previous = offlineAcked_;
+    offlineAcked_ = ackId;
+    int selfId = userId;
+    bool ok = DbExecutor::getInstance().submit([selfId, ackId] {
+        auto conn = SqlConnPool::getInstance().getConn();
+        if (!conn)
+            return;
+        SqlStatement &remove = conn->stmt(StmtId::OfflineAck);
+        if (!remove.execute(selfId, static_cast<long long>(ackId)))
+            std::cerr << "[OfflineMsg] ack delete error: " << remove.error() << std::endl;
+    });
+    if (!ok) {
+        offlineAcked_ = previous; // 允许客户端重发同一确认
+        std::cerr << "[DbExecutor] queue full, offline ack dropped for userId=" << selfId << std::endl;
+    }
+}
+
+// ─── 离线消息：存储 ──────────────────────────────────────────────────────────
+// 交给 OfflineWriter 合并写入，不占用本连接的数据库请求槽位，后续帧照常处理。
+// 回执时机见 OfflineAck：AfterFlush 落库后回复；Immediate 入队即回复，失败时补发通知。
+void ChatSession::storeOfflineMessage(int toId, int fromId, std::string content)
+{
+    std::string saved  = "user " + std::to_string(toId) + " is offline, message saved";
+    std::string failed = "user " + std::to_string(toId) + " is offline, failed to save message";
+    bool immediate = s_offlineAck == OfflineAck::Immediate;
+
+    auto self = shared_from_this();
+    bool ok = OfflineWriter::getInstance().append(toId, fromId, std::move(content),
+        [self, saved, failed, immediate](size_t stored) {
+            if (stored > 0 && immediate)
+                return;
+            self->runInStrand([self, msg = stored > 0 ? saved : failed] {
+                self->send(json{{"type", "SYSTEM"}, {"msg", msg}});
+            });
+        });
+
+    if (!ok)
+        send(json{{"type", "SYSTEM"}, {"msg", failed}});
+    else if (immediate)
+        send(json{{"type", "SYSTEM"}, {"msg", saved}});
+}
+
+void ChatSession::storeOfflineMessages(std::vector<int> toIds, int fromId, std::string content)
+{
+    size_t total = toIds.size();
+    auto self = shared_from_this();
+    bool ok = OfflineWriter::getInstance().append(std::move(toIds), fromId, std::move(content),
+        [self, total](size_t stored) {
+            if (stored == total)
+                return;
+            self->runInStrand([self, failed = total - stored] {
+                self->send(json{{"type", "SYSTEM"},
+                                {"msg", "failed to save offline message for " + std::to_string(failed) + " members"}});
+            });
+        });
+
+    if (!ok)
+        send(json{{"type", "SYSTEM"},
+                  {"msg", "failed to save offline message for " + std::to_string(total) + " members"}});
+}
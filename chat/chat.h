@@ -2,51 +2,127 @@
 #define CHAT_SESSION_H
 
 #include "buffer.h"
+#include "outputqueue.h"
+#include "msgtype.h"
+#include "codec.h"
+#include "frame.h"
+#include "groupcache.h"
+#include "offlinewriter.h"
+#include "../reactor/mpscqueue.h"
+#include "../threadpool/task.h"
 #include "nlohmann/json.hpp"
 #include <atomic>
 #include <ctime>
-#include <unordered_map>
+#include <array>
+#include <initializer_list>
 #include <exception>
-#include <functional>
 #include <memory>
 #include <unistd.h>
-#include <mutex>
 #include <string>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
+class EventLoop;
+
+// 发送优先级：发送队列超过高水位时，Low 帧直接丢弃
+enum class SendPriority {
+    Low,      // 可丢弃，如广播
+    Normal,
+};
+
 class ChatSession : public std::enable_shared_from_this<ChatSession> {
 public:
-    ChatSession(int fd);
+    ChatSession(int fd, EventLoop* loop = nullptr);
     ~ChatSession();
 
-    //核心功能组
-    void processRead();
-    void processWrite();
-    void close();
-    
+    //Session 事件，由 EventLoop 交给 Session 所属线程处理
+    enum : uint32_t { kEvRead = 1, kEvWrite = 2, kEvClose = 4 };
+
+    //核心功能组（均在 Session 所属线程执行）
+    void handleEvents(uint32_t events);   // 读 / 写 / 关闭，结束时统一写出并同步 I/O 关注
+    void close();                         // 停止收发并注销用户，fd 留给 loop 摘除后释放
+    void releaseFd();                     // EventLoop 从驱动上摘除 Session 后关闭 fd
+
+    //Strand：任意线程可投递事件，同一 Session 同一时刻只在一个线程上执行
+    void post(uint32_t events);
+    void runStrand();                     // 由 EventLoop::schedule 安排执行
+    void runInStrand(Task task);          // 线程安全：在本 Session 的 strand 中执行（如数据库请求的完成回调）
+
     //发送接口，非阻塞
-    void send(const json &message);
+    void send(const json &message, SendPriority priority = SendPriority::Normal);
+    //发送共享帧：按本连接格式取已编码的字节，不重复序列化
+    void send(const FramePtr &frame, SendPriority priority = SendPriority::Normal);
+    //转发文本 JSON：prefix + middle + suffix 为包体，middle 足够大时按引用发送
+    void sendSpliced(const std::string &prefix, const BufferSlice &middle,
+                     const std::string &suffix, SendPriority priority = SendPriority::Normal);
+    static constexpr size_t kSpliceMinBytes = 4096;
+
+    //背压：全局阈值（启动时设置）与本连接的积压情况
+    static void setOutputLimits(const OutputLimits& limits) {s_outputLimits = limits;}
+    static const OutputLimits& outputLimits() {return s_outputLimits;}
+    //离线消息回执时机（启动时设置）
+    static void setOfflineAck(OfflineAck ack) {s_offlineAck = ack;}
+    size_t queuedBytes() const {return outBytes_.load(std::memory_order_relaxed) + inboxBytes_.load(std::memory_order_relaxed);}
+    size_t droppedFrames() const {return droppedFrames_.load(std::memory_order_relaxed);}
+    bool   readPaused() const {return readPaused_ || dbInFlight_ > 0;}   // 背压或等待数据库结果，仅所属线程
 
     //获取成员组
     bool getLogin() const {return isLogin;}
     int  getUserId() const {return userId;}
-    int  getSocketFd() const {return socketFd;};
+    int  getSocketFd() const {return socketFd;}
+    bool closed() const {return isClosed;}
+    EventLoop* getLoop() const {return loop_;}
 
-    //心跳检测组
-    time_t getLastActiveTime() const {return lastActiveTime;}
-    bool checkTimeout (int timeoutSeconds);
+    //心跳检测组（CoarseClock 秒，由所属 EventLoop 的时间轮检查）
+    time_t getLastActiveTime() const {return lastActiveTime.load(std::memory_order_relaxed);}
 
-public:
-    static std::function<void(int,uint32_t)> ModEpollCallback;
+    //io_uring 驱动（loop 线程即所属线程）：数据由 loop 直接交付，待发数据由 loop 整体取走
+    void processInput(const char* data, size_t len);
+    bool takeOutput(OutputQueue& out);   // outputQueue 为空时返回 false 并撤销写请求；取走的字节在发完前仍计入积压
+    void onSendProgress(size_t inFlight); // 发送完成后剩余未发的字节，据此重新评估水位
 
 private:
     //尝试解包
+    void processRead();
+    void onInput();
     void handlePacket();
 
+    //发送路径：其他线程投递到 inbox，所属线程写入 outputQueue
+    bool inOwnerThread() const;
+    void schedule();
+    void enqueue(OutputQueue &&frame, SendPriority priority);
+    void enqueueLocal(OutputQueue &&frame, SendPriority priority);
+    void drainTasks();
+    void drainInbox();
+    void finishEvents(bool rearm);   // 写直通、水位检查、同步 I/O 关注
+    bool flush();
+    bool checkWatermarks();          // 超过 hardLimit 时关闭连接并返回 false
+    size_t pendingOutput() const {return outputQueue.bytes() + inFlightBytes_;}
+
     //业务逻辑组
-    void initHandlers();// 初始化业务处理函数映射表 
     void dispatch(const json& msgObj);// 路由分发
+    bool handleFastPath(const BufferSlice& body);// CHAT / HEARTBEAT 热路径，未处理返回 false
+    void forwardChat(int toId, const BufferSlice& content);
+
+    //数据库请求交给 DbExecutor，结果回到本 Session 的 strand（定义见 chat.cpp）
+    template <typename Work, typename Done>
+    bool submitDb(const char* respType, Work work, Done done);
+    template <typename Work>
+    bool submitDb(const char* respType, Work work);   // 完成后直接回复结果
+
+    //全进程共享的分发表，按 MsgType 下标索引
+    using Handler = void (ChatSession::*)(const json&);
+    using HandlerTable = std::array<Handler, kMsgTypeCount>;
+    struct HandlerEntry { MsgType type; Handler handler; };
+    static constexpr HandlerTable makeHandlerTable(std::initializer_list<HandlerEntry> entries)
+    {
+        HandlerTable table{};
+        for (const HandlerEntry& e : entries)
+            table[static_cast<size_t>(e.type)] = e.handler;
+        return table;
+    }
+    static const HandlerTable s_handlers;
 
     //细分业务组
     void handleLogin(const json& msg);
@@ -55,25 +131,85 @@ private:
     void handleHeartbeat(const json& msg);
     void handleAddFriend(const json& msg);
     void handleGetFriends(const json& msg);
+    void handleGroupCreate(const json& msg);
+    void handleGroupJoin(const json& msg);
+    void handleGroupLeave(const json& msg);
+    void handleGroupChat(const json& msg);
+    void handleChannelPull(const json& msg);
+    void handleOfflineAck(const json& msg);
+
+    // 登录结果回到 strand 后的公共收尾（缓存命中、查库、搭车三条路径共用）
+    void completeLogin(json&& resp, const std::string& user, WireFormat format);
+
+    // 群消息：校验成员后按群类型分派
+    void postGroupMessage(int groupId, const std::string& content, const GroupCache::GroupPtr& group);
+    // 普通群扇出：编码一次，在线成员按分片投递，离线成员合并写入
+    void fanOutGroupMessage(int groupId, const std::string& content, const std::vector<int>& members);
+    // 频道：追加到频道日志后推送在线成员，离线成员不写任何行
+    void postChannelMessage(int groupId, const std::string& content, const GroupCache::GroupPtr& group);
+
+    // 频道游标
+    void syncChannels();                               // 登录后拉取各频道游标之后的一页
+    void applyChannelPage(json& page, bool always);    // 下发一页并更新本地游标
+    void persistChannelCursors();                      // strand 内下线且积压已写空时，把频道游标推进到已下发的页末 / 稳定水位
 
     // 离线消息辅助
-    void pullOfflineMessages();
-    void storeOfflineMessage(int toId, int fromId, const std::string& content);
+    void pullOfflinePage();                            // 取游标之后的一页，发送队列排空后再取下一页
+    void resumeOfflinePull();                          // 任意线程：有待取的下一页时安排到 strand
+    void storeOfflineMessage(int toId, int fromId, std::string content);
+    void storeOfflineMessages(std::vector<int> toIds, int fromId, std::string content); // 多接收方，同一条目
 
 private:
-    int socketFd;
-    int userId;
+    const int socketFd;   // 整个生命周期不变，close 后仍占用，直到 releaseFd
+    std::atomic<int>  userId;
     std::string username_; // 登录后记录用户名
-    bool isLogin;
+    std::atomic<bool> isLogin;
     std::atomic_bool isClosed;
-    time_t lastActiveTime;
+    std::atomic_bool fdReleased_;
+    std::atomic<time_t> lastActiveTime;
 
-    
+    WireFormat inFormat_;                 // 当前正在处理的帧的编码（仅所属线程访问）
+    std::atomic<WireFormat> format_;      // 发给本连接的帧使用的编码，LOGIN 时协商
+
+    EventLoop* loop_;       // 所属 Reactor，负责该 fd 的 I/O 事件
+
+    // ── 以下写状态只由所属线程访问，无锁 ──
+    bool writeArmed_;       // 是否已关注可写（epoll EPOLLOUT / uring 在途发送）
+    bool readArmed_;        // 最近一次向 loop 声明的读关注
+    bool readPaused_;       // 超过高水位暂停读取
+    bool inEvents_;         // 正在处理一批事件，写出推迟到 finishEvents
+    int  dbInFlight_;       // 在途的数据库请求数，非 0 时暂停解析后续帧
+    size_t inFlightBytes_;  // 已由 io_uring 取走、尚未发完的字节，与 outputQueue 一起计入积压
+
+    struct ChannelCursor
+    {
+        int64_t cursor;     // 已放入发送队列的 ChannelMessage.id
+        int64_t stored;     // 库里的 read_cursor，下线且积压写空时才推进到 cursor / 稳定水位
+        bool    caughtUp;   // 已拉到最后一页，之后的消息都经实时推送
+    };
+    std::unordered_map<int, ChannelCursor> channelCursors_;   // 所属频道，登录后同步
+    int64_t offlineCursor_;  // 已下发到的 OfflineMessage.id
+    int64_t offlineAcked_;   // 客户端已确认的 id，之前的行已删除
+    OutputQueue outputQueue;
     Buffer inputBuffer;
-    Buffer outputBuffer;
-    std::mutex bufferMutex_; // 保护 Buffer 相关操作
-    std::unordered_map<std::string, std::function<void(const json&)>> handlers;
-};
 
+    // ── 跨线程投递 ──
+    struct InboxItem
+    {
+        OutputQueue frame;
+        SendPriority priority = SendPriority::Normal;
+    };
+    MpscQueue<InboxItem>     inbox_;           // 其他线程发来的已编码帧
+    MpscQueue<Task>          tasks_;           // 其他线程投递给 strand 的任务
+    std::atomic_size_t       inboxBytes_;      // inbox 中尚未取走的字节数
+    std::atomic_size_t       outBytes_;        // pendingOutput() 的镜像，供其他线程读取
+    std::atomic<uint32_t>    pendingEvents_;   // 待处理的 kEv* 事件
+    std::atomic_bool         scheduled_;       // strand 已安排或正在执行
+    std::atomic_size_t       droppedFrames_;   // 因高水位丢弃的低优先级帧数
+    std::atomic_bool         offlineWaitDrain_;// 离线消息还有下一页，等待发送队列降到低水位
+
+    static OutputLimits s_outputLimits;
+    static OfflineAck   s_offlineAck;
+};
 
 #endif
\ No newline at end of file
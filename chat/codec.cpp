@@ -0,0 +1,180 @@
+#include "codec.h"
+#include <arpa/inet.h>  // htonl
+#include <cstring>
+
+namespace codec
+{
+
+namespace
+{
+// 合法 UTF-8 的前缀长度（RFC 3629：拒绝超长编码、代理区与 U+10FFFF 以上）
+size_t validPrefix(std::string_view s)
+{
+    size_t i = 0;
+    while (i < s.size())
+    {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c < 0x80) { ++i; continue; }
+
+        size_t n;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF)      n = 1;
+        else if (c == 0xE0)              { n = 2; lo = 0xA0; }
+        else if (c == 0xED)              { n = 2; hi = 0x9F; }
+        else if (c >= 0xE1 && c <= 0xEF) n = 2;
+        else if (c == 0xF0)              { n = 3; lo = 0x90; }
+        else if (c == 0xF4)              { n = 3; hi = 0x8F; }
+        else if (c >= 0xF1 && c <= 0xF3) n = 3;
+        else return i;
+
+        if (i + n >= s.size())
+            return i;
+        unsigned char c1 = static_cast<unsigned char>(s[i + 1]);
+        if (c1 < lo || c1 > hi)
+            return i;
+        for (size_t k = 2; k <= n; ++k)
+        {
+            unsigned char ck = static_cast<unsigned char>(s[i + k]);
+            if (ck < 0x80 || ck > 0xBF)
+                return i;
+        }
+        i += n + 1;
+    }
+    return i;
+}
+
+// 非法字节逐个替换为 U+FFFD
+void repair(std::string &s)
+{
+    size_t ok = validPrefix(s);
+    if (ok == s.size())
+        return;
+
+    std::string out(s, 0, ok);
+    std::string_view rest(s);
+    rest.remove_prefix(ok);
+    while (!rest.empty())
+    {
+        out += "\xEF\xBF\xBD";
+        rest.remove_prefix(1);
+        size_t good = validPrefix(rest);
+        out.append(rest.data(), good);
+        rest.remove_prefix(good);
+    }
+    s.swap(out);
+}
+
+void repairStrings(json &value)
+{
+    if (value.is_string())
+    {
+        repair(value.get_ref<std::string &>());
+    }
+    else if (value.is_array())
+    {
+        for (json &item : value)
+            repairStrings(item);
+    }
+    else if (value.is_object())
+    {
+        bool badKey = false;
+        for (auto it = value.begin(); it != value.end(); ++it)
+        {
+            repairStrings(it.value());
+            badKey |= validPrefix(it.key()) != it.key().size();
+        }
+        if (badKey)
+        {
+            json fixed = json::object();
+            for (auto it = value.begin(); it != value.end(); ++it)
+            {
+                std::string key = it.key();
+                repair(key);
+                fixed[key] = std::move(it.value());
+            }
+            value = std::move(fixed);
+        }
+    }
+}
+} // namespace
+
+bool parseHeader(uint32_t header, WireFormat &format, uint32_t &length)
+{
+    uint32_t bits = header >> kFormatShift;
+    if (bits > static_cast<uint32_t>(WireFormat::Cbor))
+        return false;
+    format = static_cast<WireFormat>(bits);
+    length = header & kLengthMask;
+    return true;
+}
+
+std::string encodeFrame(const json &message, WireFormat format)
+{
+    // 先占 4 字节包头，包体直接编码到其后，避免再拷贝一次
+    std::string frame(sizeof(uint32_t), '\0');
+    switch (format)
+    {
+    case WireFormat::MsgPack:
+        json::to_msgpack(message, frame);
+        break;
+    case WireFormat::Cbor:
+        json::to_cbor(message, frame);
+        break;
+    case WireFormat::Json:
+    default:
+        frame += toText(message);
+        break;
+    }
+
+    uint32_t bodyLen = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+    uint32_t be32 = htonl((static_cast<uint32_t>(format) << kFormatShift) | bodyLen);
+    ::memcpy(&frame[0], &be32, sizeof(be32));
+    return frame;
+}
+
+json decode(const char *data, size_t len, WireFormat format)
+{
+    switch (format)
+    {
+    case WireFormat::MsgPack:
+    {
+        json message = json::from_msgpack(data, data + len);
+        repairStrings(message);
+        return message;
+    }
+    case WireFormat::Cbor:
+    {
+        json message = json::from_cbor(data, data + len);
+        repairStrings(message);
+        return message;
+    }
+    case WireFormat::Json:
+    default:
+        return json::parse(data, data + len);   // 解析时已校验 UTF-8
+    }
+}
+
+std::string toText(const json &message)
+{
+    return message.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+bool formatFromName(std::string_view name, WireFormat &format)
+{
+    if (name == "json")    { format = WireFormat::Json;    return true; }
+    if (name == "msgpack") { format = WireFormat::MsgPack; return true; }
+    if (name == "cbor")    { format = WireFormat::Cbor;    return true; }
+    return false;
+}
+
+const char *formatName(WireFormat format)
+{
+    switch (format)
+    {
+    case WireFormat::MsgPack: return "msgpack";
+    case WireFormat::Cbor:    return "cbor";
+    default:                  return "json";
+    }
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+/**
+ * 线上帧格式
+ *
+ *   | 4 字节大端包头 | 包体 |
+ *   包头高 2 位：包体编码（WireFormat），低 30 位：包体长度
+ *
+ * 旧客户端包头高位恒为 0，即文本 JSON，无需改动。
+ * 每个帧自带编码，服务端按帧解码；发给某连接的帧使用该连接协商的格式。
+ */
+enum class WireFormat : uint8_t
+{
+    Json    = 0,
+    MsgPack = 1,
+    Cbor    = 2,
+};
+
+namespace codec
+{
+constexpr uint32_t kFormatShift = 30;
+constexpr uint32_t kLengthMask  = (1u << kFormatShift) - 1;
+
+// 包头解析，高位为未定义的编码时返回 false
+bool parseHeader(uint32_t header, WireFormat &format, uint32_t &length);
+
+// 编码为完整帧（含包头）
+std::string encodeFrame(const json &message, WireFormat format);
+
+// 解码包体，格式错误时抛出 json::exception；
+// MessagePack / CBOR 的字符串不经 UTF-8 校验，非法字节在此替换为 U+FFFD，之后的 dump 不会再抛异常
+json decode(const char *data, size_t len, WireFormat format);
+
+// 文本 JSON 序列化（离线消息行等），非法 UTF-8 替换为 U+FFFD，不抛异常
+std::string toText(const json &message);
+
+// LOGIN 中 "format" 字段的取值："json" / "msgpack" / "cbor"
+bool formatFromName(std::string_view name, WireFormat &format);
+const char *formatName(WireFormat format);
+}
+
+#endif
@@ -0,0 +1,192 @@
+#include "credentialcache.h"
+#include <random>
+
+CredentialCache::CredentialCache()
+{
+    std::random_device rd;
+    for (size_t i = 0; i < key_.size(); i += 4)
+    {
+        uint32_t r = rd();
+        for (size_t j = 0; j < 4; ++j)
+            key_[i + j] = static_cast<uint8_t>(r >> (8 * j));
+    }
+}
+
+void CredentialCache::configure(size_t capacity, int ttlSec)
+{
+    perShard_ = (capacity + kShardCount - 1) / kShardCount;
+    ttl_      = std::chrono::seconds(ttlSec > 0 ? ttlSec : 0);
+
+    for (Shard &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.slots.clear();
+        shard.index.clear();
+        shard.hand = 0;
+        shard.slots.reserve(perShard_);
+    }
+}
+
+CredentialCache::Digest CredentialCache::digest(const std::string &user, const std::string &pwd) const
+{
+    Sha256 h;
+    h.update(key_.data(), key_.size());
+    h.update(user);
+    h.update("\0", 1);   // 分隔，避免 ("ab","c") 与 ("a","bc") 同摘要
+    h.update(pwd);
+    return h.finish();
+}
+
+std::string CredentialCache::flightKey(const std::string &user, const Digest &digest)
+{
+    std::string key(user);
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char *>(digest.data()), digest.size());
+    return key;
+}
+
+namespace
+{
+// 逐字节异或累积，耗时与摘要内容无关
+bool digestEqual(const CredentialCache::Digest &a, const CredentialCache::Digest &b)
+{
+    uint8_t diff = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+} // namespace
+
+// ────────────────────────────────────────────────────────────────────────────
+// 查找 / 写入 / 失效
+// ────────────────────────────────────────────────────────────────────────────
+std::optional<CredentialCache::Profile> CredentialCache::lookup(const std::string &user, const Digest &digest)
+{
+    Shard &shard = shardOf(user);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(user);
+        if (it != shard.index.end())
+        {
+            Slot &slot = shard.slots[it->second];
+            if (slot.expires <= Clock::now())
+            {
+                // 过期即释放槽位，下次登录重新查库
+                slot.user.clear();
+                shard.index.erase(it);
+            }
+            else if (digestEqual(slot.digest, digest))
+            {
+                slot.referenced = true;
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return slot.profile;
+            }
+            // 口令不符：保留原条目，交给数据库判定（不缓存失败结果）
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+void CredentialCache::insert(const std::string &user, const Digest &digest, const Profile &profile)
+{
+    if (perShard_ == 0)
+        return;
+
+    Shard &shard = shardOf(user);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Clock::time_point now = Clock::now();
+
+    size_t pos;
+    auto it = shard.index.find(user);
+    if (it != shard.index.end())
+    {
+        pos = it->second;
+    }
+    else if (shard.slots.size() < perShard_)
+    {
+        pos = shard.slots.size();
+        shard.slots.emplace_back();
+        shard.index.emplace(user, pos);
+    }
+    else
+    {
+        // CLOCK：空闲或过期的槽位直接复用，被引用过的给第二次机会；至多转两圈
+        for (;;)
+        {
+            Slot &slot = shard.slots[shard.hand];
+            if (slot.user.empty() || slot.expires <= now || !slot.referenced)
+                break;
+            slot.referenced = false;
+            shard.hand = (shard.hand + 1) % shard.slots.size();
+        }
+        pos = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+
+        Slot &victim = shard.slots[pos];
+        if (!victim.user.empty())
+        {
+            shard.index.erase(victim.user);
+            if (victim.expires > now)
+                evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.index.emplace(user, pos);
+    }
+
+    Slot &slot = shard.slots[pos];
+    slot.user       = user;
+    slot.digest     = digest;
+    slot.profile    = profile;
+    slot.expires    = now + ttl_;
+    slot.referenced = false;
+}
+
+void CredentialCache::invalidate(const std::string &user)
+{
+    Shard &shard = shardOf(user);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(user);
+    if (it == shard.index.end())
+        return;
+    shard.slots[it->second].user.clear();
+    shard.index.erase(it);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 单飞
+// ────────────────────────────────────────────────────────────────────────────
+bool CredentialCache::join(const std::string &user, const Digest &digest, Waiter waiter)
+{
+    Shard &shard = shardOf(user);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, leader] = shard.flights.try_emplace(flightKey(user, digest));
+    if (!leader)
+    {
+        it->second.push_back(std::move(waiter));
+        coalesced_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return leader;
+}
+
+void CredentialCache::complete(const std::string &user, const Digest &digest, const json &resp)
+{
+    std::vector<Waiter> waiters;
+    {
+        Shard &shard = shardOf(user);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.flights.find(flightKey(user, digest));
+        if (it == shard.flights.end())
+            return;
+        waiters.swap(it->second);
+        shard.flights.erase(it);
+    }
+    // 锁外回调：回调只是把结果投递到各自的 strand
+    for (Waiter &waiter : waiters)
+        waiter(resp);
+}
+
+CredentialCache::Stats CredentialCache::stats() const
+{
+    return Stats{hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+                 coalesced_.load(std::memory_order_relaxed), evictions_.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,114 @@
+#pragma once
+#ifndef CREDENTIAL_CACHE_H
+#define CREDENTIAL_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "sha256.h"
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+/**
+ * CredentialCache — 已验证凭据与用户资料缓存（单例）
+ *
+ * 滚动发布后全量用户在短时间内重连，LOGIN 的 `SELECT ... FROM User` 会在连接池前排成长队。
+ * 这里缓存最近校验通过的 (用户名 → 口令摘要, userId, 昵称)：
+ *   - 口令只以摘要形式保存：SHA-256(进程随机密钥 ‖ 用户名 ‖ 0 ‖ 口令)，比较时不提前退出。
+ *   - 分片 + CLOCK 淘汰：命中只置引用位，不移动链表；容量满时指针扫过未被引用或已过期的槽位。
+ *   - TTL 到期的条目视为未命中；REGISTER 成功后按用户名失效（资料变更的入口同样调用 invalidate）。
+ *   - 单飞：同一组凭据并发未命中时只有第一个（leader）查库，其余调用方登记回调，
+ *     leader 完成后用同一份结果回调它们（complete 必须在 leader 的每条路径上调用）。
+ */
+class CredentialCache
+{
+public:
+    using Digest = Sha256::Digest;
+    using Waiter = std::function<void(const json &resp)>;
+
+    struct Profile
+    {
+        int userId;
+        std::string nickname;
+    };
+
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t coalesced;   // 未命中但搭上了他人在途查询的次数
+        uint64_t evictions;
+    };
+
+    static CredentialCache &getInstance()
+    {
+        static CredentialCache instance;
+        return instance;
+    }
+
+    CredentialCache(const CredentialCache &) = delete;
+    CredentialCache &operator=(const CredentialCache &) = delete;
+
+    // 启动时调用；capacity 为 0 时关闭缓存（lookup 总是未命中，单飞仍然生效）
+    void configure(size_t capacity, int ttlSec);
+
+    Digest digest(const std::string &user, const std::string &pwd) const;
+
+    std::optional<Profile> lookup(const std::string &user, const Digest &digest);
+    void insert(const std::string &user, const Digest &digest, const Profile &profile);
+    void invalidate(const std::string &user);
+
+    // 返回 true 表示调用方是 leader，应执行查询并在结束时 complete；否则 waiter 已登记
+    bool join(const std::string &user, const Digest &digest, Waiter waiter);
+    void complete(const std::string &user, const Digest &digest, const json &resp);
+
+    Stats stats() const;
+
+    static constexpr size_t kShardCount = 64;   // 2 的幂
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    CredentialCache();
+
+    struct Slot
+    {
+        std::string       user;   // 空表示空闲
+        Digest            digest{};
+        Profile           profile{0, {}};
+        Clock::time_point expires;
+        bool              referenced = false;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        std::unordered_map<std::string, size_t> index;               // user → slots 下标
+        size_t hand = 0;                                              // CLOCK 指针
+        std::unordered_map<std::string, std::vector<Waiter>> flights; // 在途查询，key 见 flightKey
+    };
+
+    Shard &shardOf(const std::string &user) { return shards_[std::hash<std::string>()(user) & (kShardCount - 1)]; }
+    static std::string flightKey(const std::string &user, const Digest &digest);
+
+    std::array<Shard, kShardCount> shards_;
+    std::array<uint8_t, 32> key_;   // 进程随机密钥，摘要离开本进程即无意义
+    size_t perShard_{0};
+    Clock::duration ttl_{std::chrono::minutes(10)};
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+#endif
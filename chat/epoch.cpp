@@ -0,0 +1,139 @@
+#include "epoch.h"
+
+// 线程退出时归还记录，供之后的线程复用
+struct EpochRecordHolder
+{
+    EpochDomain::Record *record = nullptr;
+
+    ~EpochRecordHolder()
+    {
+        if (record)
+        {
+            record->epoch.store(0, std::memory_order_release);
+            record->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+namespace
+{
+thread_local EpochRecordHolder t_record;
+}
+
+EpochDomain &EpochDomain::instance()
+{
+    static EpochDomain domain;
+    return domain;
+}
+
+EpochDomain::Record *EpochDomain::localRecord()
+{
+    if (t_record.record)
+        return t_record.record;
+
+    // 先复用已退出线程留下的记录
+    for (Record *r = records_.load(std::memory_order_acquire); r; r = r->next)
+    {
+        bool expected = false;
+        if (!r->inUse.load(std::memory_order_relaxed)
+            && r->inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+        {
+            r->depth = 0;
+            return t_record.record = r;
+        }
+    }
+
+    Record *r = new Record;
+    r->inUse.store(true, std::memory_order_relaxed);
+    Record *head = records_.load(std::memory_order_relaxed);
+    do
+    {
+        r->next = head;
+    } while (!records_.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+    return t_record.record = r;
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 读侧
+// ────────────────────────────────────────────────────────────────────────────
+void EpochDomain::enter()
+{
+    Record *r = localRecord();
+    if (r->depth++ > 0)
+        return;
+
+    // 先公布所在纪元，再读快照指针；与写者的 发布 → 推进纪元 → 扫描 配对
+    r->epoch.store(global_.load(std::memory_order_acquire), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void EpochDomain::leave()
+{
+    Record *r = t_record.record;
+    if (--r->depth == 0)
+        r->epoch.store(0, std::memory_order_release);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 写侧
+// ────────────────────────────────────────────────────────────────────────────
+void EpochDomain::retire(Task reclaim)
+{
+    std::vector<Task> ready;
+    {
+        std::lock_guard<std::mutex> lock(retireMutex_);
+        // 旧快照已发布替换；此后进入的读者纪元都大于 epoch，看不到它
+        uint64_t epoch = global_.fetch_add(1, std::memory_order_acq_rel);
+        retired_.push_back(Retired{epoch, std::move(reclaim)});
+        collect(ready);
+    }
+
+    // 回收函数可能释放 Session，在锁外执行
+    for (Task &task : ready)
+        task();
+}
+
+void EpochDomain::reclaim()
+{
+    std::vector<Task> ready;
+    {
+        // 写者正持锁时它会自己 collect，这一轮跳过即可
+        std::unique_lock<std::mutex> lock(retireMutex_, std::try_to_lock);
+        if (!lock.owns_lock() || retired_.empty())
+            return;
+        collect(ready);
+    }
+
+    for (Task &task : ready)
+        task();
+}
+
+// 持有 retireMutex_：取出所有在途读者都已离开其纪元的条目
+void EpochDomain::collect(std::vector<Task> &ready)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    uint64_t minActive = UINT64_MAX;
+    for (Record *r = records_.load(std::memory_order_acquire); r; r = r->next)
+    {
+        uint64_t e = r->epoch.load(std::memory_order_acquire);
+        if (e != 0 && e < minActive)
+            minActive = e;
+    }
+
+    size_t kept = 0;
+    for (Retired &item : retired_)
+    {
+        if (item.epoch < minActive)
+            ready.push_back(std::move(item.reclaim));
+        else
+            retired_[kept++] = std::move(item);
+    }
+    retired_.resize(kept);
+}
+
+size_t EpochDomain::pendingRetired() const
+{
+    std::lock_guard<std::mutex> lock(retireMutex_);
+    return retired_.size();
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "../threadpool/task.h"
+
+/**
+ * EpochDomain — 基于纪元的延迟回收（EBR），用于读多写少的只读快照
+ *
+ * 读者：构造 EpochGuard 后读取 atomic 指针指向的快照，guard 存活期间快照不会被释放；
+ *       进出临界区各一次线程私有的原子写，不加锁、不改引用计数。
+ * 写者：发布新快照后把旧快照交给 retire()，等所有在旧纪元内进入的读者离开后才执行回收。
+ *       retire 不要在持有会被回收函数再次获取的锁时调用。
+ */
+class EpochDomain
+{
+public:
+    static EpochDomain &instance();
+
+    void enter();
+    void leave();
+
+    // 线程安全：回收函数在宽限期结束后于某个写者线程执行
+    void retire(Task reclaim);
+
+    // 线程安全：回收已过宽限期的条目。retire 只在下一次写入时顺带回收，
+    // 写入稀少时由 EventLoop 的时间轮 tick 定期调用，避免旧快照长期滞留
+    void reclaim();
+
+    template <typename T>
+    void retireObject(const T *p)
+    {
+        retire([p] { delete p; });
+    }
+
+    size_t pendingRetired() const;
+
+private:
+    EpochDomain() = default;
+
+    struct Record
+    {
+        std::atomic<uint64_t> epoch{0};     // 0 表示不在读临界区
+        std::atomic<bool>     inUse{false}; // 线程退出后可被新线程复用
+        unsigned              depth = 0;    // 嵌套 guard（仅所属线程访问）
+        Record               *next = nullptr;
+    };
+
+    struct Retired
+    {
+        uint64_t epoch;
+        Task     reclaim;
+    };
+
+    Record *localRecord();
+    void collect(std::vector<Task> &ready);
+
+    std::atomic<uint64_t> global_{1};
+    std::atomic<Record *> records_{nullptr};   // 只增不减的线程记录链表
+
+    mutable std::mutex   retireMutex_;
+    std::vector<Retired> retired_;
+
+    friend struct EpochRecordHolder;
+};
+
+class EpochGuard
+{
+public:
+    EpochGuard() { EpochDomain::instance().enter(); }
+    ~EpochGuard() { EpochDomain::instance().leave(); }
+
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+};
+
+#endif
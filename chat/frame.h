@@ -0,0 +1,48 @@
+#pragma once
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "codec.h"
+
+class Frame;
+using FramePtr = std::shared_ptr<const Frame>;
+
+/**
+ * Frame — 编码一次、多处引用的不可变帧（广播 / 多接收方投递）
+ *
+ * 每种 WireFormat 在第一次被请求时编码一次（含包头），之后所有接收方的
+ * OutputQueue 共享同一块内存，最后一个引用释放时回收。线程安全。
+ */
+class Frame
+{
+public:
+    using Bytes = std::shared_ptr<const std::string>;
+
+    static FramePtr make(json message) { return std::make_shared<const Frame>(std::move(message)); }
+
+    explicit Frame(json message) : message_(std::move(message)) {}
+
+    const json &message() const { return message_; }
+
+    // 指定格式的完整帧（含包头）
+    const Bytes &encoded(WireFormat format) const
+    {
+        size_t i = static_cast<size_t>(format);
+        std::call_once(once_[i], [this, format, i] {
+            encoded_[i] = std::make_shared<const std::string>(codec::encodeFrame(message_, format));
+        });
+        return encoded_[i];
+    }
+
+private:
+    static constexpr size_t kFormats = static_cast<size_t>(WireFormat::Cbor) + 1;
+
+    const json message_;
+    mutable std::once_flag once_[kFormats];
+    mutable Bytes encoded_[kFormats];
+};
+
+#endif
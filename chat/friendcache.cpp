@@ -0,0 +1,241 @@
+#include "friendcache.h"
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+// 条目的固定开销估算：哈希节点、LRU 节点、shared_ptr 控制块
+constexpr size_t kEntryOverhead = sizeof(int) + 96 + 32 + 32;
+} // namespace
+
+void FriendCache::configure(size_t budgetBytes)
+{
+    shardBudget_ = budgetBytes / kShardCount;
+    for (Shard &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        trim(shard);
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 登录计数
+// ────────────────────────────────────────────────────────────────────────────
+uint64_t FriendCache::stamp(int userId) const
+{
+    const Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.version;
+}
+
+bool FriendCache::acquire(int userId, std::vector<int> friends, uint64_t stamp)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Entry &entry = shard.entries[userId];
+    if (entry.cold)
+    {
+        shard.lru.erase(entry.lru);
+        entry.cold = false;
+    }
+    ++entry.pins;
+
+    if (entry.friends)
+        return true;
+
+    std::sort(friends.begin(), friends.end());
+    friends.erase(std::unique(friends.begin(), friends.end()), friends.end());
+    entry.friends = std::make_shared<const std::vector<int>>(std::move(friends));
+    resize(shard, entry);
+    trim(shard);
+    // 读取之后分片上有过 link：那次补边可能因为本行尚未缓存而被跳过
+    return shard.version == stamp;
+}
+
+void FriendCache::merge(int userId, const std::vector<int> &friends)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(userId);
+    if (it == shard.entries.end() || !it->second.friends)
+        return;
+
+    Entry &entry = it->second;
+    std::vector<int> loaded(friends);
+    std::sort(loaded.begin(), loaded.end());
+    auto next = std::make_shared<std::vector<int>>();
+    next->reserve(entry.friends->size() + loaded.size());
+    std::set_union(entry.friends->begin(), entry.friends->end(), loaded.begin(), loaded.end(),
+                   std::back_inserter(*next));
+    next->erase(std::unique(next->begin(), next->end()), next->end());
+    if (next->size() == entry.friends->size())
+        return;
+    entry.friends = std::move(next);
+    resize(shard, entry);
+    trim(shard);
+}
+
+void FriendCache::release(int userId)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(userId);
+    if (it != shard.entries.end() && it->second.pins > 0)
+        --it->second.pins;
+}
+
+void FriendCache::retire(int userId)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(userId);
+    if (it != shard.entries.end() && it->second.pins == 0 && !it->second.cold)
+    {
+        makeCold(shard, userId, it->second);
+        trim(shard);
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 好友关系
+// ────────────────────────────────────────────────────────────────────────────
+FriendCache::List FriendCache::get(int userId)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(userId);
+    if (it == shard.entries.end() || !it->second.friends)
+    {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    touch(shard, it->second);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return it->second.friends;
+}
+
+void FriendCache::link(int a, int b)
+{
+    addEdge(a, b);
+    addEdge(b, a);
+}
+
+void FriendCache::addEdge(int userId, int friendId)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.version;
+    auto it = shard.entries.find(userId);
+    if (it == shard.entries.end() || !it->second.friends)
+        return;   // 未缓存的一侧下次用到时从库里加载
+
+    Entry &entry = it->second;
+    const std::vector<int> &old = *entry.friends;
+    auto pos = std::lower_bound(old.begin(), old.end(), friendId);
+    if (pos != old.end() && *pos == friendId)
+        return;
+
+    // 复制后替换，已发出的快照不受影响
+    auto next = std::make_shared<std::vector<int>>();
+    next->reserve(old.size() + 1);
+    next->insert(next->end(), old.begin(), pos);
+    next->push_back(friendId);
+    next->insert(next->end(), pos, old.end());
+    entry.friends = std::move(next);
+    resize(shard, entry);
+    trim(shard);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 用户资料
+// ────────────────────────────────────────────────────────────────────────────
+void FriendCache::setProfile(int userId, std::string username, std::string nickname)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.entries.try_emplace(userId);
+    Entry &entry = it->second;
+    entry.username = std::move(username);
+    entry.nickname = std::move(nickname);
+    if (inserted)
+        makeCold(shard, userId, entry);
+    resize(shard, entry);
+    trim(shard);
+}
+
+bool FriendCache::known(int userId)
+{
+    Shard &shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.entries.count(userId) != 0;
+}
+
+bool FriendCache::profiles(const std::vector<int> &ids, std::vector<Profile> &out)
+{
+    out.clear();
+    out.reserve(ids.size());
+    for (int id : ids)
+    {
+        Shard &shard = shardOf(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(id);
+        if (it == shard.entries.end() || it->second.username.empty())
+        {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        touch(shard, it->second);
+        out.push_back(Profile{it->second.username, it->second.nickname});
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+FriendCache::Stats FriendCache::stats() const
+{
+    Stats s{hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+            evictions_.load(std::memory_order_relaxed), 0, 0};
+    for (const Shard &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        s.entries += shard.entries.size();
+        s.bytes   += shard.bytes;
+    }
+    return s;
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 预算与淘汰
+// ────────────────────────────────────────────────────────────────────────────
+void FriendCache::touch(Shard &shard, Entry &entry)
+{
+    if (entry.cold)
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+}
+
+void FriendCache::makeCold(Shard &shard, int userId, Entry &entry)
+{
+    entry.lru  = shard.lru.insert(shard.lru.begin(), userId);
+    entry.cold = true;
+}
+
+void FriendCache::resize(Shard &shard, Entry &entry)
+{
+    size_t bytes = kEntryOverhead + entry.username.capacity() + entry.nickname.capacity();
+    if (entry.friends)
+        bytes += entry.friends->capacity() * sizeof(int);
+    shard.bytes = shard.bytes - entry.bytes + bytes;
+    entry.bytes = bytes;
+}
+
+void FriendCache::trim(Shard &shard)
+{
+    while (shard.bytes > shardBudget_ && !shard.lru.empty())
+    {
+        auto it = shard.entries.find(shard.lru.back());
+        shard.lru.pop_back();
+        shard.bytes -= it->second.bytes;
+        shard.entries.erase(it);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
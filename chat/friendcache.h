@@ -0,0 +1,121 @@
+#pragma once
+#ifndef FRIEND_CACHE_H
+#define FRIEND_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * FriendCache — 好友关系图与用户资料缓存（单例）
+ *
+ * 每个用户一行有序的好友 id（不可变快照，读者拿到 shared_ptr 后无需加锁），外加用户名 / 昵称。
+ * 登录时随账号校验一起加载（已缓存则直接复用），GET_FRIENDS 查库时顺带补齐好友资料，
+ * ADD_FRIEND 提交后双向补边。好友列表、重复添加检查和上下线推送都只读这里。
+ *
+ * 所有 Friend 写入都经过本进程并在提交后调用 link，因此已缓存的行始终是最新的，
+ * 用户下线后条目可以继续保留。link 只更新已缓存的一侧，为避免"登录读到旧列表、新边已先到"
+ * 的遗漏，读 Friend 表前先取 stamp()，acquire 时若分片在此期间有过 link，列表照常装入
+ * （上下线推送离不开它），但返回 false，由调用方重新加载后 merge 补齐。条目状态：
+ *   - 已登录（pins > 0）、或计数归零但下线事件尚未发布：常驻，不参与淘汰；
+ *   - retire 之后、以及只有资料的条目：进入分片的 LRU，总占用超过预算时从冷端淘汰。
+ * 常驻条目不受预算限制，预算只约束冷数据。
+ */
+class FriendCache
+{
+public:
+    using List = std::shared_ptr<const std::vector<int>>;
+
+    struct Profile
+    {
+        std::string username;
+        std::string nickname;
+    };
+
+    struct Stats
+    {
+        uint64_t hits;        // get / profiles 命中
+        uint64_t misses;
+        uint64_t evictions;
+        size_t   entries;
+        size_t   bytes;       // 估算占用，含常驻条目
+    };
+
+    static FriendCache &getInstance()
+    {
+        static FriendCache instance;
+        return instance;
+    }
+
+    FriendCache(const FriendCache &) = delete;
+    FriendCache &operator=(const FriendCache &) = delete;
+
+    void configure(size_t budgetBytes);                    // 启动时调用：冷数据的内存预算
+
+    uint64_t stamp(int userId) const;                      // 读好友列表（库或缓存）之前调用
+    // 登录成功：计数 +1；已缓存的行比刚读到的更新，保留。装入的列表可能漏边时返回 false
+    bool acquire(int userId, std::vector<int> friends, uint64_t stamp);
+    void merge(int userId, const std::vector<int> &friends);   // 重新加载的结果并入已缓存的行（关系只增不删）
+    void release(int userId);                              // 已登录的 Session 关闭：计数 -1
+    void retire(int userId);                               // 下线事件发布后：计数为 0 时转为可淘汰
+
+    List get(int userId);                                  // 未缓存返回 nullptr
+    void link(int a, int b);                               // 新增好友关系，只更新已缓存的一侧
+
+    void setProfile(int userId, std::string username, std::string nickname);
+    bool known(int userId);                                // 有条目即说明用户存在（用户不会被删除）
+    bool profiles(const std::vector<int> &ids, std::vector<Profile> &out);   // 全部命中才返回 true
+
+    Stats stats() const;
+
+    static constexpr size_t kShardCount = 64;   // 2 的幂
+
+private:
+    FriendCache() = default;
+
+    struct Entry
+    {
+        List        friends;          // nullptr：只缓存了资料
+        std::string username;         // 空：资料未知
+        std::string nickname;
+        int         pins = 0;
+        bool        cold = false;     // 在 LRU 中，可被淘汰
+        std::list<int>::iterator lru;
+        size_t      bytes = 0;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<int, Entry> entries;
+        std::list<int> lru;   // 冷条目，front 最近使用
+        size_t bytes = 0;
+        uint64_t version = 0; // 每次 link 涉及本分片时递增
+    };
+
+    Shard &shardOf(int userId) { return shards_[static_cast<size_t>(userId) & (kShardCount - 1)]; }
+    const Shard &shardOf(int userId) const { return shards_[static_cast<size_t>(userId) & (kShardCount - 1)]; }
+
+    // 以下均在持有分片锁时调用
+    void touch(Shard &shard, Entry &entry);
+    void makeCold(Shard &shard, int userId, Entry &entry);
+    void resize(Shard &shard, Entry &entry);   // 重新估算条目占用
+    void trim(Shard &shard);                   // 超出预算时从冷端淘汰
+
+    void addEdge(int userId, int friendId);
+
+    std::array<Shard, kShardCount> shards_;
+    size_t shardBudget_{(64u << 20) / kShardCount};
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "groupcache.h"
+#include <algorithm>
+
+GroupCache::GroupPtr GroupCache::get(int groupId) const
+{
+    const Shard &shard = shardOf(groupId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.groups.find(groupId);
+    return it != shard.groups.end() ? it->second : nullptr;
+}
+
+uint64_t GroupCache::stamp(int groupId) const
+{
+    const Shard &shard = shardOf(groupId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.version;
+}
+
+GroupCache::GroupPtr GroupCache::put(int groupId, Group group, uint64_t stamp)
+{
+    std::vector<int> &members = group.members;
+    std::sort(members.begin(), members.end());
+    members.erase(std::unique(members.begin(), members.end()), members.end());
+    auto entry = std::make_shared<const Group>(std::move(group));
+
+    Shard &shard = shardOf(groupId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.groups.find(groupId);
+    if (it != shard.groups.end())
+        return it->second;   // 已被其他加载者写入，以先写入的为准
+    if (shard.version != stamp)
+        return entry;        // 加载期间有成员变更，本次结果只用一次，不入缓存
+    shard.groups.emplace(groupId, entry);
+    return entry;
+}
+
+void GroupCache::addMember(int groupId, int userId)
+{
+    Shard &shard = shardOf(groupId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.version;
+    auto it = shard.groups.find(groupId);
+    if (it == shard.groups.end())
+        return;
+
+    const std::vector<int> &old = it->second->members;
+    auto pos = std::lower_bound(old.begin(), old.end(), userId);
+    if (pos != old.end() && *pos == userId)
+        return;
+
+    // 复制后替换，正在扇出的快照不受影响
+    auto next = std::make_shared<Group>();
+    next->channel = it->second->channel;
+    next->members.reserve(old.size() + 1);
+    next->members.insert(next->members.end(), old.begin(), pos);
+    next->members.push_back(userId);
+    next->members.insert(next->members.end(), pos, old.end());
+    it->second = std::move(next);
+}
+
+void GroupCache::removeMember(int groupId, int userId)
+{
+    Shard &shard = shardOf(groupId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.version;
+    auto it = shard.groups.find(groupId);
+    if (it == shard.groups.end())
+        return;
+
+    const std::vector<int> &old = it->second->members;
+    auto pos = std::lower_bound(old.begin(), old.end(), userId);
+    if (pos == old.end() || *pos != userId)
+        return;
+
+    auto next = std::make_shared<Group>();
+    next->channel = it->second->channel;
+    next->members.reserve(old.size() - 1);
+    next->members.insert(next->members.end(), old.begin(), pos);
+    next->members.insert(next->members.end(), pos + 1, old.end());
+    it->second = std::move(next);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef GROUP_CACHE_H
+#define GROUP_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * GroupCache — 群成员缓存（单例）
+ *
+ * GROUP_CHAT 的热路径只读这里：命中时不访问数据库，群类型与有序成员列表是不可变的快照，
+ * 扇出期间无需加锁。未命中时由调用方从 ChatGroup / GroupMember 表加载后 put 回来。
+ *
+ * 建群 / 加入 / 退出在数据库提交后调用 addMember / removeMember，只修改已缓存的群。
+ * 为避免"加载读到旧数据、成员变更已先到"的覆盖，加载前先取 stamp()，put 时若分片
+ * 在此期间有过成员变更则放弃写入，下一条消息再重新加载。
+ */
+class GroupCache
+{
+public:
+    struct Group
+    {
+        bool channel = false;      // 频道：消息写入频道日志，成员按游标拉取
+        std::vector<int> members;  // 升序
+    };
+    using GroupPtr = std::shared_ptr<const Group>;
+
+    static GroupCache &getInstance()
+    {
+        static GroupCache instance;
+        return instance;
+    }
+
+    GroupCache(const GroupCache &) = delete;
+    GroupCache &operator=(const GroupCache &) = delete;
+
+    GroupPtr get(int groupId) const;   // 未缓存返回 nullptr
+
+    uint64_t stamp(int groupId) const;                      // 加载前调用
+    GroupPtr put(int groupId, Group group, uint64_t stamp); // 返回写入（或已有）的快照
+
+    void addMember(int groupId, int userId);
+    void removeMember(int groupId, int userId);
+
+    static constexpr size_t kShardCount = 64;   // 2 的幂
+
+private:
+    GroupCache() = default;
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<int, GroupPtr> groups;
+        uint64_t version = 0;   // 每次成员变更 +1
+    };
+
+    Shard &shardOf(int groupId) { return shards_[static_cast<size_t>(groupId) & (kShardCount - 1)]; }
+    const Shard &shardOf(int groupId) const { return shards_[static_cast<size_t>(groupId) & (kShardCount - 1)]; }
+
+    std::array<Shard, kShardCount> shards_;
+};
+
+#endif
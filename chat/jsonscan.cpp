@@ -0,0 +1,235 @@
+#include "jsonscan.h"
+#include <charconv>
+
+namespace jsonscan
+{
+namespace detail
+{
+
+static const int kMaxDepth = 64;
+
+size_t skipWs(std::string_view s, size_t pos)
+{
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r'))
+        ++pos;
+    return pos;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// pos 指向反斜杠，解析 \uXXXX 的码元，非法返回 -1
+static long unicodeEscape(std::string_view s, size_t pos)
+{
+    if (pos + 6 > s.size() || s[pos] != '\\' || s[pos + 1] != 'u')
+        return -1;
+    long unit = 0;
+    for (size_t i = pos + 2; i < pos + 6; ++i)
+    {
+        int v = hexValue(s[i]);
+        if (v < 0)
+            return -1;
+        unit = (unit << 4) | v;
+    }
+    return unit;
+}
+
+// 校验一个 UTF-8 多字节序列，返回其长度，非法返回 0
+static size_t utf8Length(std::string_view s, size_t pos)
+{
+    unsigned char c = static_cast<unsigned char>(s[pos]);
+    size_t len;
+    uint32_t min;
+    if (c >= 0xC2 && c <= 0xDF)      { len = 2; min = 0x80; }
+    else if (c >= 0xE0 && c <= 0xEF) { len = 3; min = 0x800; }
+    else if (c >= 0xF0 && c <= 0xF4) { len = 4; min = 0x10000; }
+    else return 0;
+
+    if (pos + len > s.size())
+        return 0;
+    uint32_t cp = c & (0x3F >> (len - 1));
+    for (size_t i = 1; i < len; ++i)
+    {
+        unsigned char cc = static_cast<unsigned char>(s[pos + i]);
+        if ((cc & 0xC0) != 0x80)
+            return 0;
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        return 0;
+    return len;
+}
+
+size_t scanString(std::string_view s, size_t pos, bool &escaped)
+{
+    const size_t npos = std::string_view::npos;
+    escaped = false;
+    ++pos; // 跳过开引号
+    while (pos < s.size())
+    {
+        unsigned char c = static_cast<unsigned char>(s[pos]);
+        if (c == '"')
+            return pos + 1;
+        if (c < 0x20)
+            return npos;
+        if (c == '\\')
+        {
+            escaped = true;
+            if (pos + 1 >= s.size())
+                return npos;
+            char e = s[pos + 1];
+            if (e == 'u')
+            {
+                // 代理码元必须成对：高代理后紧跟低代理，孤立的任一半在 DOM 解析时会抛异常
+                long unit = unicodeEscape(s, pos);
+                if (unit < 0 || (unit >= 0xDC00 && unit <= 0xDFFF))
+                    return npos;
+                if (unit >= 0xD800 && unit <= 0xDBFF)
+                {
+                    long low = unicodeEscape(s, pos + 6);
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return npos;
+                    pos += 6;
+                }
+                pos += 6;
+            }
+            else if (e == '"' || e == '\\' || e == '/' || e == 'b' || e == 'f'
+                     || e == 'n' || e == 'r' || e == 't')
+            {
+                pos += 2;
+            }
+            else
+            {
+                return npos;
+            }
+            continue;
+        }
+        if (c < 0x80)
+        {
+            ++pos;
+            continue;
+        }
+        size_t len = utf8Length(s, pos);
+        if (len == 0)
+            return npos;
+        pos += len;
+    }
+    return npos;
+}
+
+static size_t scanNumber(std::string_view s, size_t pos)
+{
+    const size_t npos = std::string_view::npos;
+    size_t start = pos;
+    if (pos < s.size() && s[pos] == '-')
+        ++pos;
+    if (pos >= s.size())
+        return npos;
+    if (s[pos] == '0')
+        ++pos;
+    else if (s[pos] >= '1' && s[pos] <= '9')
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') ++pos;
+    else
+        return npos;
+
+    if (pos < s.size() && s[pos] == '.')
+    {
+        size_t digits = ++pos;
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') ++pos;
+        if (pos == digits) return npos;
+    }
+    if (pos < s.size() && (s[pos] == 'e' || s[pos] == 'E'))
+    {
+        ++pos;
+        if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) ++pos;
+        size_t digits = pos;
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') ++pos;
+        if (pos == digits) return npos;
+    }
+    return pos > start ? pos : npos;
+}
+
+size_t scanValue(std::string_view s, size_t pos, int depth)
+{
+    const size_t npos = std::string_view::npos;
+    if (pos >= s.size() || depth > kMaxDepth)
+        return npos;
+
+    bool escaped;
+    switch (s[pos])
+    {
+    case '"':
+        return scanString(s, pos, escaped);
+
+    case '{':
+    case '[':
+    {
+        bool isObject = s[pos] == '{';
+        char close = isObject ? '}' : ']';
+        pos = skipWs(s, pos + 1);
+        if (pos < s.size() && s[pos] == close)
+            return pos + 1;
+        while (pos < s.size())
+        {
+            if (isObject)
+            {
+                if (s[pos] != '"')
+                    return npos;
+                pos = scanString(s, pos, escaped);
+                if (pos == npos)
+                    return npos;
+                pos = skipWs(s, pos);
+                if (pos >= s.size() || s[pos] != ':')
+                    return npos;
+                pos = skipWs(s, pos + 1);
+            }
+            pos = scanValue(s, pos, depth + 1);
+            if (pos == npos)
+                return npos;
+            pos = skipWs(s, pos);
+            if (pos >= s.size())
+                return npos;
+            if (s[pos] == close)
+                return pos + 1;
+            if (s[pos] != ',')
+                return npos;
+            pos = skipWs(s, pos + 1);
+        }
+        return npos;
+    }
+
+    case 't':
+        return s.substr(pos, 4) == "true" ? pos + 4 : npos;
+    case 'f':
+        return s.substr(pos, 5) == "false" ? pos + 5 : npos;
+    case 'n':
+        return s.substr(pos, 4) == "null" ? pos + 4 : npos;
+
+    default:
+        return scanNumber(s, pos);
+    }
+}
+
+}
+
+bool rawString(std::string_view raw, std::string_view &out)
+{
+    if (raw.size() < 2 || raw.front() != '"' || raw.find('\\') != std::string_view::npos)
+        return false;
+    out = raw.substr(1, raw.size() - 2);
+    return true;
+}
+
+bool rawInt(std::string_view raw, int &out)
+{
+    const char *end = raw.data() + raw.size();
+    auto result = std::from_chars(raw.data(), end, out);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * jsonscan — 文本 JSON 的按需扫描（热路径专用）
+ *
+ * 只遍历顶层对象，给出每个字段的键与原始值（未解码的 JSON 片段），不建 DOM。
+ * 扫描时顺带校验语法（含字符串转义、\u 代理对与 UTF-8），校验通过的原始值可直接拼进转发帧。
+ * 任何不合法或不支持的输入都返回 false，调用方回退到 nlohmann DOM 路径。
+ */
+namespace jsonscan
+{
+
+struct Field
+{
+    std::string_view key;   // 键（引号内原文，含转义时 keyEscaped 为 true）
+    std::string_view raw;   // 值的原始 JSON 片段
+    bool keyEscaped;
+};
+
+// 遍历顶层对象的字段，对每个字段调用 fn(const Field&)
+template <typename Fn>
+bool forEachField(std::string_view text, Fn &&fn);
+
+// 原始值为不含转义的字符串时取出引号内内容
+bool rawString(std::string_view raw, std::string_view &out);
+// 原始值为 int 范围内的整数时取出
+bool rawInt(std::string_view raw, int &out);
+
+namespace detail
+{
+size_t skipWs(std::string_view s, size_t pos);
+// pos 指向 '"'，返回结束引号之后的位置，非法返回 npos
+size_t scanString(std::string_view s, size_t pos, bool &escaped);
+// 返回值之后的位置，非法返回 npos
+size_t scanValue(std::string_view s, size_t pos, int depth);
+}
+
+template <typename Fn>
+bool forEachField(std::string_view text, Fn &&fn)
+{
+    using detail::skipWs;
+    const size_t npos = std::string_view::npos;
+
+    size_t pos = skipWs(text, 0);
+    if (pos >= text.size() || text[pos] != '{')
+        return false;
+    pos = skipWs(text, pos + 1);
+
+    if (pos < text.size() && text[pos] == '}')
+        return skipWs(text, pos + 1) == text.size();
+
+    while (pos < text.size())
+    {
+        if (text[pos] != '"')
+            return false;
+        Field field;
+        size_t keyEnd = detail::scanString(text, pos, field.keyEscaped);
+        if (keyEnd == npos)
+            return false;
+        field.key = text.substr(pos + 1, keyEnd - pos - 2);
+
+        pos = skipWs(text, keyEnd);
+        if (pos >= text.size() || text[pos] != ':')
+            return false;
+        pos = skipWs(text, pos + 1);
+
+        size_t valueEnd = detail::scanValue(text, pos, 1);
+        if (valueEnd == npos)
+            return false;
+        field.raw = text.substr(pos, valueEnd - pos);
+        fn(static_cast<const Field &>(field));
+
+        pos = skipWs(text, valueEnd);
+        if (pos >= text.size())
+            return false;
+        if (text[pos] == '}')
+            return skipWs(text, pos + 1) == text.size();
+        if (text[pos] != ',')
+            return false;
+        pos = skipWs(text, pos + 1);
+    }
+    return false;
+}
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef MSG_TYPE_H
+#define MSG_TYPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * MsgType — 协议消息类型，解析时由 "type" 字符串驻留为小整数
+ *
+ * 新增消息类型：在枚举中加一项，在 kMsgTypeNames 中登记它的协议名，
+ * 再到 ChatSession 的分发表（chat.cpp）里登记处理函数。
+ */
+enum class MsgType : uint8_t
+{
+    Unknown = 0,
+    Login,
+    Register,
+    Chat,
+    Heartbeat,
+    AddFriend,
+    GetFriends,
+    GroupCreate,
+    GroupJoin,
+    GroupLeave,
+    GroupChat,
+    ChannelPull,
+    OfflineAck,
+
+    Count
+};
+
+constexpr size_t kMsgTypeCount = static_cast<size_t>(MsgType::Count);
+
+struct MsgTypeName
+{
+    std::string_view name;
+    MsgType type;
+};
+
+inline constexpr MsgTypeName kMsgTypeNames[] = {
+    {"LOGIN",        MsgType::Login},
+    {"REGISTER",     MsgType::Register},
+    {"CHAT",         MsgType::Chat},
+    {"HEARTBEAT",    MsgType::Heartbeat},
+    {"ADD_FRIEND",   MsgType::AddFriend},
+    {"GET_FRIENDS",  MsgType::GetFriends},
+    {"GROUP_CREATE", MsgType::GroupCreate},
+    {"GROUP_JOIN",   MsgType::GroupJoin},
+    {"GROUP_LEAVE",  MsgType::GroupLeave},
+    {"GROUP_CHAT",   MsgType::GroupChat},
+    {"CHANNEL_PULL", MsgType::ChannelPull},
+    {"OFFLINE_ACK",  MsgType::OfflineAck},
+};
+
+// 协议名 → MsgType，未登记的返回 Unknown
+constexpr MsgType msgTypeFromName(std::string_view name)
+{
+    for (const MsgTypeName &entry : kMsgTypeNames)
+        if (entry.name == name)
+            return entry.type;
+    return MsgType::Unknown;
+}
+
+constexpr std::string_view msgTypeName(MsgType type)
+{
+    for (const MsgTypeName &entry : kMsgTypeNames)
+        if (entry.type == type)
+            return entry.name;
+    return "UNKNOWN";
+}
+
+static_assert(msgTypeFromName("CHAT") == MsgType::Chat, "kMsgTypeNames out of sync");
+static_assert(sizeof(kMsgTypeNames) / sizeof(kMsgTypeNames[0]) == kMsgTypeCount - 1,
+              "every MsgType needs a protocol name");
+
+#endif
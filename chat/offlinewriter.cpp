@@ -0,0 +1,255 @@
+#include "offlinewriter.h"
+#include "../mysql/sqlConnectionPool.h"
+#include <algorithm>
+#include <iostream>
+
+OfflineWriter::~OfflineWriter()
+{
+    stop();
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 启动 / 停止
+// ────────────────────────────────────────────────────────────────────────────
+void OfflineWriter::start(int flushMs, size_t batchRows, size_t maxQueueRows)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+        return;
+
+    flushInterval_ = std::chrono::milliseconds(flushMs > 0 ? flushMs : 0);
+    batchRows_     = batchRows > 0 ? batchRows : 1;
+    maxQueueRows_  = maxQueueRows;
+    running_       = true;
+    thread_ = std::thread([this] { run(); });
+
+    std::cout << "[OfflineWriter] Started, flush every " << flushMs << "ms or "
+              << batchRows_ << " rows, queue limit " << maxQueueRows_ << std::endl;
+}
+
+void OfflineWriter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_)
+            return;
+        running_ = false;
+    }
+    cond_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+
+    Stats s = stats();
+    std::cout << "[OfflineWriter] Stopped: " << s.rowsWritten << " rows in " << s.flushes
+              << " flushes, " << s.rowsFailed << " failed, " << s.rejected << " rejected" << std::endl;
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 追加
+// ────────────────────────────────────────────────────────────────────────────
+bool OfflineWriter::append(std::vector<int> toIds, int fromId, std::string content, Done done)
+{
+    if (toIds.empty())
+        return false;
+
+    Entry entry;
+    entry.toIds   = std::move(toIds);
+    entry.fromId  = fromId;
+    entry.content = std::move(content);
+    entry.done    = std::move(done);
+    return push(std::move(entry));
+}
+
+bool OfflineWriter::barrier(Done done)
+{
+    Entry entry;
+    entry.done = std::move(done);
+    return push(std::move(entry));
+}
+
+bool OfflineWriter::push(Entry entry)
+{
+    size_t rows = entry.toIds.size();
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || (rows > 0 && queuedRows_ + rows > maxQueueRows_))
+        {
+            rejected_ += rows;
+            return false;
+        }
+
+        entry.queuedAt = Clock::now();
+        // 空队列的第一条开始计时；攒满一批或有 barrier 时立即唤醒
+        wake = queue_.empty() || queuedRows_ + rows >= batchRows_ || rows == 0;
+        if (rows == 0)
+            urgent_ = true;
+        queuedRows_ += rows;
+        queue_.push_back(std::move(entry));
+    }
+    if (wake)
+        cond_.notify_one();
+    return true;
+}
+
+OfflineWriter::Stats OfflineWriter::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return Stats{queuedRows_, flushes_, rowsWritten_, rowsFailed_, rejected_, lastLatencyUs_, maxLatencyUs_};
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 写入线程
+// ────────────────────────────────────────────────────────────────────────────
+void OfflineWriter::run()
+{
+    std::deque<Entry> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        if (queue_.empty())
+        {
+            if (!running_)
+                return; // 已停止且队列排空
+            cond_.wait(lock);
+            continue;
+        }
+
+        // 窗口未到、未攒满、也没有 barrier：继续等
+        Clock::time_point deadline = queue_.front().queuedAt + flushInterval_;
+        if (running_ && !urgent_ && queuedRows_ < batchRows_ && Clock::now() < deadline)
+        {
+            cond_.wait_until(lock, deadline);
+            continue;
+        }
+
+        batch.swap(queue_);
+        queuedRows_ = 0;
+        urgent_     = false;
+
+        // 刷写期间允许新的 append 进入
+        lock.unlock();
+        flush(batch);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void OfflineWriter::flush(std::deque<Entry> &batch)
+{
+    std::vector<size_t> stored(batch.size(), 0);
+    size_t total = 0;
+    for (const Entry &entry : batch)
+        total += entry.toIds.size();
+
+    if (total > 0)
+    {
+        auto conn = SqlConnPool::getInstance().getConn();
+        if (!conn)
+            std::cerr << "[OfflineWriter] Cannot store " << total << " rows: database unavailable" << std::endl;
+
+        // 行数随批次变化，拼成多行文本 INSERT；每条语句至多 batchRows_ 行、kMaxStatementBytes 字节，
+        // 长消息多的批次不会超过服务端的 max_allowed_packet
+        static const char kInsertHead[] = "INSERT INTO OfflineMessage(to_userid, from_userid, content) VALUES";
+        std::string sql, escaped;
+        std::vector<std::pair<size_t, int>> rowsInSql;   // 本条语句包含的 (条目下标, 接收方)
+
+        auto appendRow = [](std::string &out, bool first, int toId, int fromId, const std::string &text) {
+            out += first ? "(" : ",(";
+            out += std::to_string(toId);
+            out += ',';
+            out += std::to_string(fromId);
+            out += ",'";
+            out += text;
+            out += "')";
+        };
+
+        auto execute = [&] {
+            if (rowsInSql.empty())
+                return;
+            if (mysql_real_query(conn->mysql(), sql.data(), sql.size()) == 0)
+            {
+                for (const auto &row : rowsInSql)
+                    ++stored[row.first];
+                rowsInSql.clear();
+                return;
+            }
+
+            unsigned int err = mysql_errno(conn->mysql());
+            std::cerr << "[OfflineWriter] batch store error: " << mysql_error(conn->mysql()) << std::endl;
+
+            // 断线时整条语句可能已经提交，逐行重试会写出重复行；其余错误下多行 INSERT 整体未生效，
+            // 逐行重写，一行坏数据不连累同批的其他消息
+            if (err != 2006 && err != 2013)   // CR_SERVER_GONE_ERROR / CR_SERVER_LOST
+            {
+                std::string single, text;
+                for (const auto &[index, toId] : rowsInSql)
+                {
+                    const Entry &entry = batch[index];
+                    text.resize(entry.content.size() * 2 + 1);
+                    text.resize(mysql_real_escape_string(conn->mysql(), &text[0],
+                                                         entry.content.c_str(), entry.content.size()));
+                    single.assign(kInsertHead);
+                    appendRow(single, true, toId, entry.fromId, text);
+                    if (mysql_real_query(conn->mysql(), single.data(), single.size()) == 0)
+                        ++stored[index];
+                    else
+                        std::cerr << "[OfflineWriter] row store error (to " << toId << "): "
+                                  << mysql_error(conn->mysql()) << std::endl;
+                }
+            }
+            rowsInSql.clear();
+        };
+
+        for (size_t i = 0; conn && i < batch.size(); ++i)
+        {
+            const Entry &entry = batch[i];
+            if (entry.toIds.empty())
+                continue;
+
+            // 同一条目的所有接收方共用同一份内容，只转义一次
+            escaped.resize(entry.content.size() * 2 + 1);
+            escaped.resize(mysql_real_escape_string(conn->mysql(), &escaped[0],
+                                                    entry.content.c_str(), entry.content.size()));
+
+            for (int toId : entry.toIds)
+            {
+                // 两个整数、逗号、引号与括号至多 32 字节
+                if (!rowsInSql.empty() && sql.size() + escaped.size() + 32 > kMaxStatementBytes)
+                    execute();
+                if (rowsInSql.empty())
+                    sql.assign(kInsertHead);
+                appendRow(sql, rowsInSql.empty(), toId, entry.fromId, escaped);
+                rowsInSql.emplace_back(i, toId);
+
+                if (rowsInSql.size() == batchRows_)
+                    execute();
+            }
+        }
+        if (conn)
+            execute();
+    }
+
+    size_t written = 0;
+    for (size_t n : stored)
+        written += n;
+    uint64_t latencyUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - batch.front().queuedAt).count());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (total > 0)
+        {
+            ++flushes_;
+            rowsWritten_  += written;
+            rowsFailed_   += total - written;
+            lastLatencyUs_ = latencyUs;
+            maxLatencyUs_  = std::max(maxLatencyUs_, latencyUs);
+        }
+    }
+
+    // 连接已归还后再回调，回调里可以放心地继续投递数据库任务
+    for (size_t i = 0; i < batch.size(); ++i)
+        if (batch[i].done)
+            batch[i].done(stored[i]);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef OFFLINE_WRITER_H
+#define OFFLINE_WRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 离线消息回执时机
+enum class OfflineAck
+{
+    AfterFlush,   // 写入数据库后才回复发送者 "message saved"
+    Immediate,    // 入队即回复；写入失败时再补发一条失败通知
+};
+
+/**
+ * OfflineWriter — 离线消息写后合并（单例）
+ *
+ * 所有网络线程把离线消息追加到同一个队列，专用线程每隔 flushMs 毫秒、或攒满 batchRows 行时
+ * 取走整个队列，合并成多行 INSERT OfflineMessage 写入。热门用户下线后的消息风暴因此变成
+ * 每个窗口一两条语句，而不是每条消息借一次连接。单条语句按行数和字节数双重封顶；
+ * 整条语句失败（非断线）时逐行重写，只有真正写不进去的行计为失败。
+ *
+ * 追加方可带一个完成回调（在写入线程调用，参数为实际写入的行数），用于回执或失败通知。
+ * barrier 在队列末尾放一个空条目：之前追加的消息全部落库后才回调，登录时用它保证
+ * 拉取离线消息能看到下线前刚写入队列的消息。
+ */
+class OfflineWriter
+{
+public:
+    using Done = std::function<void(size_t stored)>;
+
+    struct Stats
+    {
+        size_t   queuedRows;      // 当前排队行数
+        uint64_t flushes;         // 已执行的刷写次数
+        uint64_t rowsWritten;
+        uint64_t rowsFailed;
+        uint64_t rejected;        // 队列满被拒绝的行数
+        uint64_t lastLatencyUs;   // 最近一次刷写：最早一行从入队到落库的时间
+        uint64_t maxLatencyUs;
+    };
+
+    static OfflineWriter &getInstance()
+    {
+        static OfflineWriter instance;
+        return instance;
+    }
+
+    OfflineWriter(const OfflineWriter &) = delete;
+    OfflineWriter &operator=(const OfflineWriter &) = delete;
+
+    /**
+     * 启动写入线程
+     * @param flushMs      合并窗口：第一行入队后最多等待的毫秒数
+     * @param batchRows    攒满即刷写的行数，也是单条 INSERT 的最大行数
+     * @param maxQueueRows 排队行数上限，超出后 append 返回 false
+     */
+    void start(int flushMs, size_t batchRows, size_t maxQueueRows);
+    // 停止接收新消息，刷写完已排队的消息后退出（幂等）
+    void stop();
+
+    // 线程安全、非阻塞：未运行或队列已满时返回 false，done 不会被调用
+    bool append(std::vector<int> toIds, int fromId, std::string content, Done done = nullptr);
+    bool append(int toId, int fromId, std::string content, Done done = nullptr)
+    {
+        return append(std::vector<int>{toId}, fromId, std::move(content), std::move(done));
+    }
+
+    // 之前追加的消息全部刷写后调用 done(0)；未运行时返回 false
+    bool barrier(Done done);
+
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // 单条 INSERT 的字节上限，低于 MySQL 默认 max_allowed_packet（4 MB / 8.0 为 64 MB）
+    static constexpr size_t kMaxStatementBytes = 1024 * 1024;
+
+    struct Entry
+    {
+        std::vector<int>  toIds;
+        int               fromId = 0;
+        std::string       content;
+        Done              done;
+        Clock::time_point queuedAt;
+    };
+
+    OfflineWriter() = default;
+    ~OfflineWriter();
+
+    bool push(Entry entry);
+    void run();
+    void flush(std::deque<Entry> &batch);
+
+private:
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    bool running_{false};
+
+    Clock::duration flushInterval_{std::chrono::milliseconds(5)};
+    size_t batchRows_{500};
+    size_t maxQueueRows_{0};
+
+    std::deque<Entry> queue_;
+    size_t queuedRows_{0};
+    bool   urgent_{false};   // 队列中有 barrier，不必等满窗口
+
+    // 统计（mutex_ 保护）
+    uint64_t flushes_{0};
+    uint64_t rowsWritten_{0};
+    uint64_t rowsFailed_{0};
+    uint64_t rejected_{0};
+    uint64_t lastLatencyUs_{0};
+    uint64_t maxLatencyUs_{0};
+};
+
+#endif
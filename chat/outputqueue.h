@@ -0,0 +1,138 @@
+#pragma once
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <deque>
+#include <string>
+#include <cassert>
+#include <sys/uio.h>    // struct iovec, writev
+#include <memory>
+#include "buffer.h"
+
+/**
+ * OutputLimits — 单个连接发送队列的背压阈值（字节）
+ *
+ *   >= highWatermark：丢弃低优先级帧（广播等），并暂停读取该连接，直到降回 lowWatermark 以下
+ *   >  hardLimit    ：判定为慢消费者，丢弃队列并断开连接
+ */
+struct OutputLimits
+{
+    size_t highWatermark = 1 * 1024 * 1024;
+    size_t lowWatermark  = 256 * 1024;
+    size_t hardLimit     = 8 * 1024 * 1024;
+};
+
+/**
+ * OutputQueue — 待发送帧队列
+ *
+ * 每个元素是一段待发数据：编码好的帧（4 字节长度头 + 消息体）、多个队列共享的
+ * 已编码帧（广播），或直接引用输入 Buffer 中数据的 BufferSlice（零拷贝转发）。发送时把队首若干段
+ * 填进 iovec 一次 writev / sendmsg 写出，不再先拼进一块连续缓冲区。
+ */
+class OutputQueue
+{
+public:
+    static const int kMaxIov = 64;
+
+    bool   empty() const { return segments_.empty(); }
+    size_t bytes() const { return bytes_; }
+
+    void push(std::string frame)
+    {
+        if (frame.empty())
+            return;
+        bytes_ += frame.size();
+        size_t len = frame.size();
+        segments_.push_back({std::move(frame), nullptr, BlockRef(), 0, len});
+    }
+
+    // 共享的已编码帧，只增加引用计数
+    void push(const std::shared_ptr<const std::string> &shared)
+    {
+        if (!shared || shared->empty())
+            return;
+        bytes_ += shared->size();
+        segments_.push_back({std::string(), shared, BlockRef(), 0, shared->size()});
+    }
+
+    void push(const BufferSlice &slice)
+    {
+        bytes_ += slice.size();
+        for (const BufferSlice::Piece &piece : slice.pieces())
+            segments_.push_back({std::string(), nullptr, piece.block, piece.offset, piece.len});
+    }
+
+    // 整体接到队尾（rhs 被清空）
+    void append(OutputQueue &&rhs)
+    {
+        bytes_ += rhs.bytes_;
+        for (Segment &seg : rhs.segments_)
+            segments_.push_back(std::move(seg));
+        rhs.clear();
+    }
+
+    // 返回填入的 iovec 个数
+    int fillIov(struct iovec *iov, int maxIov) const
+    {
+        int n = 0;
+        for (auto it = segments_.begin(); it != segments_.end() && n < maxIov; ++it, ++n)
+        {
+            iov[n].iov_base = const_cast<char *>(it->data());
+            iov[n].iov_len = it->len;
+        }
+        return n;
+    }
+
+    // 已写出 n 字节
+    void consume(size_t n)
+    {
+        assert(n <= bytes_);
+        bytes_ -= n;
+        while (n > 0)
+        {
+            Segment &front = segments_.front();
+            if (n < front.len)
+            {
+                front.offset += n;
+                front.len -= n;
+                return;
+            }
+            n -= front.len;
+            segments_.pop_front();
+        }
+    }
+
+    void clear()
+    {
+        segments_.clear();
+        bytes_ = 0;
+    }
+
+    void swap(OutputQueue &rhs)
+    {
+        segments_.swap(rhs.segments_);
+        std::swap(bytes_, rhs.bytes_);
+    }
+
+private:
+    struct Segment
+    {
+        std::string frame;                          // 自有数据
+        std::shared_ptr<const std::string> shared;  // 或共享的已编码帧
+        BlockRef    block;                          // 或引用 Buffer 中的 Block
+        size_t      offset;                         // 尚未发送部分的起点
+        size_t      len;                            // 尚未发送的字节数
+
+        const char *data() const
+        {
+            if (block)  return block.data() + offset;
+            if (shared) return shared->data() + offset;
+            return frame.data() + offset;
+        }
+    };
+
+    std::deque<Segment> segments_;
+    size_t bytes_ = 0;        // 队列中尚未发送的总字节数
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "presence.h"
+
+PresenceIndex::~PresenceIndex()
+{
+    for (auto &seg : segments_)
+        delete seg.load(std::memory_order_relaxed);
+}
+
+PresenceIndex::Segment *PresenceIndex::segmentFor(uint32_t index)
+{
+    Segment *seg = segments_[index].load(std::memory_order_acquire);
+    if (seg)
+        return seg;
+
+    // 不同分片的写者可能同时分配同一段，只保留先发布的那个
+    Segment *fresh = new Segment;
+    if (segments_[index].compare_exchange_strong(seg, fresh, std::memory_order_acq_rel))
+        return fresh;
+    delete fresh;
+    return seg;
+}
+
+bool PresenceIndex::setOnline(int userId, bool online)
+{
+    if (userId < 0)
+        return false;
+
+    uint32_t id  = static_cast<uint32_t>(userId);
+    uint32_t bit = id % kSegmentBits;
+    uint64_t mask = uint64_t(1) << (bit % 64);
+
+    if (online)
+    {
+        Segment *seg = segmentFor(id / kSegmentBits);
+        uint64_t prev = seg->words[bit / 64].fetch_or(mask, std::memory_order_relaxed);
+        if (prev & mask)
+            return false;
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        Segment *seg = segments_[id / kSegmentBits].load(std::memory_order_acquire);
+        if (!seg)
+            return false;
+        uint64_t prev = seg->words[bit / 64].fetch_and(~mask, std::memory_order_relaxed);
+        if (!(prev & mask))
+            return false;
+        count_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void PresenceIndex::onlineMask(const int *ids, size_t count, uint8_t *out) const
+{
+    uint32_t cachedWord = UINT32_MAX; // 上次读出的字（全局字号 id / 64），好友 id 相近时省去重复读取
+    uint64_t word = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (ids[i] < 0)
+        {
+            out[i] = 0;
+            continue;
+        }
+
+        uint32_t id = static_cast<uint32_t>(ids[i]);
+        uint32_t globalWord = id / 64;
+        if (globalWord != cachedWord)
+        {
+            const Segment *seg = segments_[id / kSegmentBits].load(std::memory_order_acquire);
+            word = seg ? seg->words[(id % kSegmentBits) / 64].load(std::memory_order_relaxed) : 0;
+            cachedWord = globalWord;
+        }
+        out[i] = static_cast<uint8_t>((word >> (id % 64)) & 1);
+    }
+}
+
+std::vector<uint8_t> PresenceIndex::onlineMask(const std::vector<int> &ids) const
+{
+    std::vector<uint8_t> mask(ids.size());
+    onlineMask(ids.data(), ids.size(), mask.data());
+    return mask;
+}
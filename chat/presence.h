@@ -0,0 +1,62 @@
+#pragma once
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * PresenceIndex — 按 userId 索引的在线位图
+ *
+ * 位图按 64K 位一段懒分配（8KB），段一经分配不再释放，查询只做两次 relaxed 原子读，
+ * 不加锁、不分配内存；好友列表的在线状态因此是 O(好友数)，与在线总人数无关。
+ * 写入由 UserManager 在分片写锁内完成，同一 userId 的置位 / 清位天然串行。
+ */
+class PresenceIndex
+{
+public:
+    static constexpr uint32_t kSegmentBits = 1u << 16;
+    static constexpr uint32_t kSegmentWords = kSegmentBits / 64;
+    static constexpr uint32_t kMaxSegments = 1u << 15;   // 覆盖 0 .. 2^31-1
+
+    PresenceIndex() = default;
+    ~PresenceIndex();
+
+    PresenceIndex(const PresenceIndex &) = delete;
+    PresenceIndex &operator=(const PresenceIndex &) = delete;
+
+    bool setOnline(int userId, bool online);   // 返回该位是否真的翻转
+
+    bool isOnline(int userId) const
+    {
+        if (userId < 0)
+            return false;
+        const Segment *seg = segments_[static_cast<uint32_t>(userId) / kSegmentBits].load(std::memory_order_acquire);
+        if (!seg)
+            return false;
+        uint32_t bit = static_cast<uint32_t>(userId) % kSegmentBits;
+        return (seg->words[bit / 64].load(std::memory_order_relaxed) >> (bit % 64)) & 1;
+    }
+
+    // 批量查询：out[i] = ids[i] 是否在线；相邻 id 落在同一字时复用已读出的字
+    void onlineMask(const int *ids, size_t count, uint8_t *out) const;
+    std::vector<uint8_t> onlineMask(const std::vector<int> &ids) const;
+
+    size_t onlineCount() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+    struct Segment
+    {
+        std::array<std::atomic<uint64_t>, kSegmentWords> words{};
+    };
+
+    Segment *segmentFor(uint32_t index);
+
+    std::array<std::atomic<Segment *>, kMaxSegments> segments_{};
+    std::atomic<size_t> count_{0};
+};
+
+#endif
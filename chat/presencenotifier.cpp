@@ -0,0 +1,105 @@
+#include "presencenotifier.h"
+#include "friendcache.h"
+#include "usermanager.h"
+#include <vector>
+
+PresenceNotifier::~PresenceNotifier()
+{
+    stop();
+}
+
+void PresenceNotifier::start(int windowMs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+        return;
+
+    window_  = std::chrono::milliseconds(windowMs > 0 ? windowMs : 0);
+    running_ = true;
+    UserManager::getInstance().setPresenceListener([this](int userId) { markDirty(userId); });
+    thread_ = std::thread([this] { run(); });
+}
+
+void PresenceNotifier::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_)
+            return;
+        running_ = false;
+        due_.clear();
+        dirty_.clear();
+    }
+    cond_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void PresenceNotifier::markDirty(int userId)
+{
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || !dirty_.insert(userId).second)
+            return; // 窗口内已登记，等到期时统一比较
+        first = due_.empty();
+        due_.emplace_back(Clock::now() + window_, userId);
+    }
+    if (first)
+        cond_.notify_one();
+}
+
+void PresenceNotifier::run()
+{
+    std::vector<int> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (running_)
+    {
+        if (due_.empty())
+        {
+            cond_.wait(lock);
+            continue;
+        }
+
+        Clock::time_point deadline = due_.front().first;
+        if (Clock::now() < deadline)
+        {
+            cond_.wait_until(lock, deadline);
+            continue;
+        }
+
+        Clock::time_point now = Clock::now();
+        while (!due_.empty() && due_.front().first <= now)
+        {
+            batch.push_back(due_.front().second);
+            dirty_.erase(due_.front().second);
+            due_.pop_front();
+        }
+
+        // 发布期间允许新的 markDirty 进入
+        lock.unlock();
+        for (int userId : batch)
+            publish(userId);
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void PresenceNotifier::publish(int userId)
+{
+    bool online = UserManager::getInstance().isOnline(userId);
+
+    if (announced_.setOnline(userId, online))
+    {
+        if (FriendCache::List friends = FriendCache::getInstance().get(userId))
+        {
+            json msg = {{"type", "PRESENCE"}, {online ? "online" : "offline", json::array({userId})}};
+            UserManager::getInstance().sendToMany(*friends, Frame::make(std::move(msg)));
+        }
+    }
+
+    // 下线事件已发出（或被合并掉），好友列表转为冷数据，内存紧张时可淘汰
+    if (!online)
+        FriendCache::getInstance().retire(userId);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef PRESENCE_NOTIFIER_H
+#define PRESENCE_NOTIFIER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "presence.h"
+
+/**
+ * PresenceNotifier — 上下线推送（单例）
+ *
+ * UserManager 的在线位图翻转时调用 markDirty，这里只记下 userId；窗口（默认 1 秒）
+ * 到期后读取当时的在线状态，与上次发布的状态不同才向其在线好友推送一帧：
+ *
+ *     {"type":"PRESENCE","online":[id]}   /   {"type":"PRESENCE","offline":[id]}
+ *
+ * 窗口内的反复断线重连（上线-下线-上线）因此合并为零次或一次推送；状态以位图为准，
+ * 回调到达的先后顺序不影响结果。好友列表取自 FriendCache，同一帧只编码一次。
+ *
+ * 已发布的状态单独保存在 announced_ 位图里。登录时的初始快照、新加好友时的补发都读它
+ * 而不是 UserManager 的实时位图：客户端看到的状态总是某次已发布的状态，之后的变化
+ * 一定会推送过来，不会因为窗口合并而漏掉下线事件。
+ */
+class PresenceNotifier
+{
+public:
+    static PresenceNotifier &getInstance()
+    {
+        static PresenceNotifier instance;
+        return instance;
+    }
+
+    PresenceNotifier(const PresenceNotifier &) = delete;
+    PresenceNotifier &operator=(const PresenceNotifier &) = delete;
+
+    // 启动推送线程并挂到 UserManager 上；需在网络线程启动前调用
+    void start(int windowMs);
+    // 停止推送，未到期的变更直接丢弃（幂等）
+    void stop();
+
+    // 线程安全：userId 的在线状态可能变了
+    void markDirty(int userId);
+
+    // 已向好友发布的在线状态（线程安全）
+    bool isAnnounced(int userId) const { return announced_.isOnline(userId); }
+    std::vector<uint8_t> announcedMask(const std::vector<int> &ids) const { return announced_.onlineMask(ids); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    PresenceNotifier() = default;
+    ~PresenceNotifier();
+
+    void run();
+    void publish(int userId);
+
+private:
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool running_{false};
+    Clock::duration window_{std::chrono::seconds(1)};
+
+    std::deque<std::pair<Clock::time_point, int>> due_;   // 按到期时间有序
+    std::unordered_set<int> dirty_;                        // 已在 due_ 中的 userId
+
+    PresenceIndex announced_;   // 仅推送线程写入
+};
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Sha256 — FIPS 180-4 SHA-256（增量接口）
+ *
+ * 供凭据缓存计算口令摘要，进程内不保存明文口令。不依赖外部加密库。
+ *
+ *   Sha256 h;
+ *   h.update(key); h.update(user); h.update(pwd);
+ *   Sha256::Digest d = h.finish();
+ */
+class Sha256
+{
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    void update(const void *data, size_t len);
+    void update(std::string_view s) { update(s.data(), s.size()); }
+    Digest finish();   // 之后对象不可再用
+
+    static Digest hash(std::string_view s)
+    {
+        Sha256 h;
+        h.update(s);
+        return h.finish();
+    }
+
+private:
+    void compress(const uint8_t *block);
+
+    uint32_t state_[8];
+    uint8_t  buffer_[64];
+    size_t   buffered_;
+    uint64_t totalBytes_;
+};
+
+#endif
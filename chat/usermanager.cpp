@@ -1,82 +1,214 @@
 #include "usermanager.h"
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 
-void UserManager::addSession(int userId, std::shared_ptr<ChatSession> session) {
- 
-    // 写锁，独占访问
-    std::unique_lock<std::shared_mutex> lock(m_mutex);
-    auto it = m_users.find(userId);
-    if (it != m_users.end()) {
-        // 可以选择在这里给旧 Session 发送一个“被顶下线”的消息
-    }  
-    m_users[userId] = session;
-    // 可以在这里打印日志
-    // std::cout << "User " << userId << " logged in. Total: " << m_users.size() << std::endl;
+UserManager::UserManager() {
+    // 先构造 EpochDomain，保证它晚于 UserManager 析构
+    EpochDomain::instance();
+}
+
+UserManager::~UserManager() {
+    for (Shard& shard : shards_)
+        delete shard.table.load(std::memory_order_relaxed);
 }
 
-void UserManager::removeSession(int userId) {
-    // 写锁，独占访问
-    std::unique_lock<std::shared_mutex> lock(m_mutex);
-    auto it = m_users.find(userId);
-    if (it != m_users.end()) {
-        m_users.erase(it);
-        // std::cout << "User " << userId << " logged out. Total: " << m_users.size() << std::endl;
+ChatSession* UserManager::find(const Table* table, int userId) {
+    if (!table)
+        return nullptr;
+    auto it = std::lower_bound(table->begin(), table->end(), userId,
+                               [](const Entry& e, int id) { return e.userId < id; });
+    return (it != table->end() && it->userId == userId) ? it->session : nullptr;
+}
+
+// ─── 注册 / 注销：复制本分片快照，改好后原子替换 ─────────────────────────────
+void UserManager::addSession(int userId, std::shared_ptr<ChatSession> session) {
+    Shard& shard = shards_[shardOf(userId)];
+    const Table* old = nullptr;
+    std::shared_ptr<ChatSession> replaced;
+    bool flipped = false;
+
+    {
+        std::lock_guard<std::mutex> lock(shard.writeMutex);
+        auto& owner = shard.owners[userId];
+        replaced = std::move(owner); // 可以选择在这里给旧 Session 发送一个“被顶下线”的消息
+        owner = session;
+
+        old = shard.table.load(std::memory_order_relaxed);
+        Table* next = old ? new Table(*old) : new Table;
+        auto it = std::lower_bound(next->begin(), next->end(), userId,
+                                   [](const Entry& e, int id) { return e.userId < id; });
+        if (it != next->end() && it->userId == userId)
+            it->session = session.get();
+        else
+            next->insert(it, Entry{userId, session.get()});
+        shard.table.store(next, std::memory_order_release);
+        flipped = presence_.setOnline(userId, true);
     }
+
+    // 旧快照和被替换的 Session 可能仍被无锁读者引用，宽限期后再释放
+    EpochDomain::instance().retire([old, replaced = std::move(replaced)]() mutable {
+        delete old;
+        replaced.reset();
+    });
+
+    if (flipped && presenceListener_)
+        presenceListener_(userId);
 }
 
-bool UserManager::sendTo(int toUserId, const json& msg) {
-    std::shared_ptr<ChatSession> target = nullptr;
+void UserManager::removeSession(int userId, const ChatSession* session) {
+    Shard& shard = shards_[shardOf(userId)];
+    const Table* old = nullptr;
+    std::shared_ptr<ChatSession> removed;
+    bool flipped = false;
 
     {
-        std::shared_lock<std::shared_mutex> lock(m_mutex);
-        auto it = m_users.find(toUserId);
-        if (it != m_users.end()) {
-            target = it->second; // 增加引用计数，确保发送时对象活着
-        }
-    } // 尽早释放锁
+        std::lock_guard<std::mutex> lock(shard.writeMutex);
+        auto it = shard.owners.find(userId);
+        if (it == shard.owners.end() || it->second.get() != session)
+            return; // 已被同一用户的新 Session 顶替，不能误删新映射
+        removed = std::move(it->second);
+        shard.owners.erase(it);
+        flipped = presence_.setOnline(userId, false);
+
+        old = shard.table.load(std::memory_order_relaxed);
+        Table* next = new Table;
+        next->reserve(old->size() - 1);
+        for (const Entry& e : *old)
+            if (e.userId != userId)
+                next->push_back(e);
+        shard.table.store(next, std::memory_order_release);
+    }
+
+    EpochDomain::instance().retire([old, removed = std::move(removed)]() mutable {
+        delete old;
+        removed.reset();
+    });
 
-    if (target){
+    if (flipped && presenceListener_)
+        presenceListener_(userId);
+}
+
+// ─── 查找与转发：EpochGuard 内读快照，无锁 ──────────────────────────────────
+bool UserManager::sendTo(int toUserId, const FramePtr& frame, SendPriority priority) {
+    return withSession(toUserId, [&](ChatSession& target) { target.send(frame, priority); });
+}
+
+bool UserManager::sendTo(int toUserId, const json& msg) {
+    bool sent = false;
+    withSession(toUserId, [&](ChatSession& target) {
         try {
-            target->send(msg);
-            return true; // 发送成功
+            target.send(msg);
+            sent = true; // 发送成功
         } catch (...) {
             // 发送失败，可能连接已断开
             // 可以选择在这里记录日志
             // std::cout << "Failed to send message to user " << toUserId << std::endl;
         }
-    }
+    });
 
     // 用户不在线或发送失败
-    return false; // 提示调用者可以处理离线逻辑
+    return sent; // 提示调用者可以处理离线逻辑
+}
+
+std::shared_ptr<ChatSession> UserManager::getSession(int userId) const {
+    EpochGuard guard;
+    ChatSession* session = find(shards_[shardOf(userId)].table.load(std::memory_order_acquire), userId);
+    return session ? session->shared_from_this() : nullptr;
+}
+
+template <typename Fn>
+void UserManager::forEachOnline(const std::vector<int>& ids, Fn&& fn) const {
+    // 按分片分组，同一分片只读一次快照指针
+    std::vector<size_t> order(ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&ids](size_t a, size_t b) { return shardOf(ids[a]) < shardOf(ids[b]); });
+
+    size_t current = kShardCount;
+    const Table* table = nullptr;
+    for (size_t i : order) {
+        size_t shard = shardOf(ids[i]);
+        if (shard != current) {
+            current = shard;
+            table = shards_[shard].table.load(std::memory_order_acquire);
+        }
+        if (ChatSession* session = find(table, ids[i]))
+            fn(i, session);
+    }
+}
+
+std::vector<std::shared_ptr<ChatSession>> UserManager::lookupMany(const std::vector<int>& ids) const {
+    std::vector<std::shared_ptr<ChatSession>> result(ids.size());
+    EpochGuard guard;
+    forEachOnline(ids, [&result](size_t i, ChatSession* session) {
+        result[i] = session->shared_from_this();
+    });
+    return result;
 }
 
-size_t UserManager::getOnlineCount() const {
-    // 读锁
-    std::shared_lock<std::shared_mutex> lock(m_mutex);
-    return m_users.size();
+std::vector<int> UserManager::sendToMany(const std::vector<int>& ids, const FramePtr& frame,
+                                         SendPriority priority) {
+    std::vector<char> delivered(ids.size(), 0);
+    {
+        EpochGuard guard;
+        forEachOnline(ids, [&](size_t i, ChatSession* session) {
+            session->send(frame, priority);
+            delivered[i] = 1;
+        });
+    }
+
+    std::vector<int> offline;
+    for (size_t i = 0; i < ids.size(); ++i)
+        if (!delivered[i])
+            offline.push_back(ids[i]);
+    return offline;
 }
 
+// ─── 统计与监控 ─────────────────────────────────────────────────────────────
 std::vector<int> UserManager::getOnlineUsers() const {
-    // 读锁
-    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    EpochGuard guard;
     std::vector<int> users;
-    users.reserve(m_users.size());
-    for (const auto& pair : m_users) {
-        users.push_back(pair.first);
-    }
+    for (const Shard& shard : shards_)
+        if (const Table* table = shard.table.load(std::memory_order_acquire))
+            for (const Entry& e : *table)
+                users.push_back(e.userId);
     return users;
 }
 
+std::vector<std::pair<int, size_t>> UserManager::getSlowSessions(size_t minQueued) const {
+    EpochGuard guard;
+    std::vector<std::pair<int, size_t>> slow;
+    for (const Shard& shard : shards_) {
+        const Table* table = shard.table.load(std::memory_order_acquire);
+        if (!table)
+            continue;
+        for (const Entry& e : *table) {
+            size_t queued = e.session->queuedBytes();
+            if (queued >= minQueued)
+                slow.emplace_back(e.userId, queued);
+        }
+    }
+    return slow;
+}
+
+// ─── 广播 ───────────────────────────────────────────────────────────────────
 void UserManager::broadcast(const json& msg) {
-    // 读锁
-    std::shared_lock<std::shared_mutex> lock(m_mutex);
-    for (const auto& pair : m_users) {
-        if (pair.second != nullptr) {
-             try {
-                pair.second->send(msg);
+    broadcast(Frame::make(msg));
+}
+
+void UserManager::broadcast(const FramePtr& frame, SendPriority priority) {
+    // 快照本身不可变，遍历期间登录 / 下线不受影响
+    EpochGuard guard;
+    for (const Shard& shard : shards_) {
+        const Table* table = shard.table.load(std::memory_order_acquire);
+        if (!table)
+            continue;
+        for (const Entry& e : *table) {
+            try {
+                e.session->send(frame, priority); // 慢消费者超过高水位时丢弃
             } catch (...) {
                 // 忽略单个发送失败，避免影响广播给其他人
-                // 也可以记录日志
             }
         }
     }
@@ -2,16 +2,29 @@
 #define USER_MANAGER_H
 
 
-#include <unordered_map>
-#include <shared_mutex>
+#include <array>
+#include <atomic>
 #include <mutex>
 #include "chat.h"
+#include "epoch.h"
+#include "presence.h"
 #include "nlohmann/json.hpp"
 #include <vector>
 #include <memory>
+#include <functional>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
+/**
+ * UserManager — 在线用户注册表（单例）
+ *
+ * 按 userId 分成 kShardCount 个分片，每个分片发布一份只读快照（按 userId 排序的数组）：
+ *   - 查找 / 转发：EpochGuard 内读快照，不加锁，也不增减 shared_ptr 引用计数；
+ *   - 登录 / 下线：只锁对应分片，复制快照改好后原子替换，旧快照与被替换的强引用
+ *     交给 EpochDomain，等读者离开后再释放；同时更新在线位图 PresenceIndex，
+ *     位图真正翻转时（重复登录顶替不算）在锁外通知 PresenceListener。
+ */
 class UserManager {
 public:
     static UserManager& getInstance() {
@@ -23,27 +36,79 @@ public:
     UserManager(const UserManager&) = delete;
     UserManager& operator=(const UserManager&) = delete;
 
+    // 在线状态翻转时回调（userId），在锁外调用；需在网络线程启动前设置
+    using PresenceListener = std::function<void(int)>;
+    void setPresenceListener(PresenceListener listener) { presenceListener_ = std::move(listener); }
+
     // 1. 在线映射管理 & 2. 线程安全的注册与注销
     void addSession(int userId, std::shared_ptr<ChatSession> session);
-    void removeSession(int userId);
+    void removeSession(int userId, const ChatSession* session); // 只在映射仍指向该 Session 时移除
 
     // 3. 消息转发中转
     bool sendTo(int toUserId, const json& msg);
+    bool sendTo(int toUserId, const FramePtr& frame, SendPriority priority = SendPriority::Normal);
+    std::shared_ptr<ChatSession> getSession(int userId) const; // 不在线返回 nullptr
+
+    // 转发热路径：在线时在 EpochGuard 内调用 fn(ChatSession&) 并返回 true，不持有引用
+    template <typename Fn>
+    bool withSession(int userId, Fn&& fn) const {
+        EpochGuard guard;
+        ChatSession* session = find(shards_[shardOf(userId)].table.load(std::memory_order_acquire), userId);
+        if (!session)
+            return false;
+        fn(*session);
+        return true;
+    }
+
+    // 批量查找：结果与 ids 一一对应（不在线为 nullptr），同一分片的 id 共用一次快照读取
+    std::vector<std::shared_ptr<ChatSession>> lookupMany(const std::vector<int>& ids) const;
+    // 批量投递同一帧，返回不在线的 userId
+    std::vector<int> sendToMany(const std::vector<int>& ids, const FramePtr& frame,
+                                SendPriority priority = SendPriority::Normal);
+
+    // 在线状态：读位图，O(1) / O(ids.size())，不依赖在线总人数
+    bool isOnline(int userId) const { return presence_.isOnline(userId); }
+    std::vector<uint8_t> onlineMask(const std::vector<int>& ids) const { return presence_.onlineMask(ids); }
 
     // 4. 统计与监控
-    size_t getOnlineCount() const;
+    size_t getOnlineCount() const { return presence_.onlineCount(); }
     std::vector<int> getOnlineUsers() const;
+    std::vector<std::pair<int, size_t>> getSlowSessions(size_t minQueued) const; // userId -> 发送队列积压字节
 
-    // 5. 广播功能
+    // 5. 广播功能：帧只编码一次，遍历快照发送
     void broadcast(const json& msg);
+    void broadcast(const FramePtr& frame, SendPriority priority = SendPriority::Low);
+
+    static constexpr size_t kShardCount = 64;   // 2 的幂
+    static_assert((kShardCount & (kShardCount - 1)) == 0, "kShardCount must be a power of two");
 
 private:
-    UserManager() = default;
-    ~UserManager() = default;
+    UserManager();
+    ~UserManager();
+
+    struct Entry {
+        int userId;
+        ChatSession* session;   // 强引用由 Shard::owners 持有
+    };
+    using Table = std::vector<Entry>;   // 按 userId 升序
+
+    struct alignas(64) Shard {
+        std::atomic<const Table*> table{nullptr};
+        std::mutex writeMutex;   // 只串行化本分片的写者
+        std::unordered_map<int, std::shared_ptr<ChatSession>> owners;   // writeMutex 保护
+    };
+
+    static size_t shardOf(int userId) { return static_cast<size_t>(userId) & (kShardCount - 1); }
+    static ChatSession* find(const Table* table, int userId);
+
+    // 必须在 EpochGuard 内调用：对每个在线的 id 调用 fn(index, session)
+    template <typename Fn>
+    void forEachOnline(const std::vector<int>& ids, Fn&& fn) const;
 
-    std::unordered_map<int, std::shared_ptr<ChatSession>> m_users; // UserID -> ChatSession 
-    mutable std::shared_mutex m_mutex; // 读写锁
+    std::array<Shard, kShardCount> shards_;
+    PresenceIndex presence_;   // 与 owners 同步更新（分片写锁内）
+    PresenceListener presenceListener_;
 };
 
 
-#endif
\ No newline at end of file
+#endif
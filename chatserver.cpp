@@ -1,5 +1,10 @@
 #include "chatserver.h"
-#include "chat/usermanager.h"
+#include "chat/credentialcache.h"
+#include "chat/friendcache.h"
+#include "chat/offlinewriter.h"
+#include "chat/presencenotifier.h"
+#include "reactor/epollloop.h"
+#include "reactor/uringloop.h"
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -9,9 +14,8 @@
 #include <cerrno>
 #include <cstring>
 #include <stdexcept>
-#include <chrono>
-#include <vector>
-#include <cassert>
+#include <iostream>
+#include <algorithm>
 
 // 辅助函数：将 fd 设置为非阻塞
 static int setNonBlocking(int fd)
@@ -22,263 +26,217 @@ static int setNonBlocking(int fd)
 }
 
 // 构造 / 析构
-ChatServer::ChatServer(int port, int threadNum)
-    : port_(port), listenFd_(-1), epollFd_(-1), running_(false)
+ChatServer::ChatServer(const ServerOptions& options)
+    : options_(options), running_(false), nextLoop_(0)
 {
-    initSocket();
-    initEpoll();
-
-    // 将 Epoll 修改回调注入到 ChatSession（static 成员）
-    // 当 Session 内部需要切换监听事件（如切换到 EPOLLOUT）时调用
-    ChatSession::ModEpollCallback = [this](int fd, uint32_t events) {
-        epollMod(fd, events);
-    };
+    ChatSession::setOutputLimits(options_.outputLimits);
+    ChatSession::setOfflineAck(options_.offlineAck);
+    CredentialCache::getInstance().configure(options_.credentialCacheSize, options_.credentialTtlSec);
+    FriendCache::getInstance().configure(options_.friendCacheBytes);
+    OfflineWriter::getInstance().start(options_.offlineFlushMs, options_.offlineBatchRows, options_.offlineQueueRows);
+    PresenceNotifier::getInstance().start(options_.presenceWindowMs);
+    initReactors();
+}
 
-    threadpool_ = std::make_unique<Threadpool>(threadNum);
+ChatServer::ChatServer(int port, int threadNum)
+    : ChatServer([port, threadNum] {
+          ServerOptions options;
+          options.port      = port;
+          options.threadNum = threadNum;
+          return options;
+      }())
+{
 }
 
 ChatServer::~ChatServer()
 {
     running_ = false;
-    if (timerThread_.joinable())
-        timerThread_.join();
 
-    if (listenFd_ >= 0) ::close(listenFd_);
-    if (epollFd_  >= 0) ::close(epollFd_);
+    // 推送线程、离线写入线程会向 Session 投递，先于网络线程停止（排队的离线消息在此写完）
+    PresenceNotifier::getInstance().stop();
+    OfflineWriter::getInstance().stop();
+
+    for (auto& loop : subLoops_)
+        loop->quit();
+    if (baseLoop_)
+        baseLoop_->quit();
+
+    for (auto& t : loopThreads_)
+        if (t.joinable()) t.join();
+
+    // 先停线程池，Worker 中的任务还引用着 EventLoop
+    threadpool_.reset();
+
+    for (int fd : listenFds_)
+        ::close(fd);
+
+    CredentialCache::Stats cs = CredentialCache::getInstance().stats();
+    std::cout << "[CredentialCache] hits=" << cs.hits << " misses=" << cs.misses
+              << " coalesced=" << cs.coalesced << " evictions=" << cs.evictions << std::endl;
+
+    FriendCache::Stats fs = FriendCache::getInstance().stats();
+    std::cout << "[FriendCache] hits=" << fs.hits << " misses=" << fs.misses << " evictions=" << fs.evictions
+              << " entries=" << fs.entries << " bytes=" << fs.bytes << std::endl;
 }
 
-// 1. 底层网络驱动 —— Socket & Epoll 初始化
+// 1. 底层网络驱动 —— Socket & Reactor 初始化
 
-void ChatServer::initSocket()
+int ChatServer::createListenSocket(bool reusePort)
 {
-    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0)
+    int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0)
         throw std::runtime_error("socket() failed: " + std::string(strerror(errno)));
 
     // 地址重用，快速重启服务时不阻塞
     int opt = 1;
-    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // 多个监听 Socket 绑定同一端口，由内核按四元组哈希分摊新连接
+    if (reusePort && ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        ::close(listenFd);
+        return -1;
+    }
 
     sockaddr_in addr{};
     addr.sin_family      = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port        = htons(port_);
+    addr.sin_port        = htons(options_.port);
 
-    if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        ::close(listenFd);
+        if (reusePort) return -1;
         throw std::runtime_error("bind() failed: " + std::string(strerror(errno)));
+    }
 
-    if (::listen(listenFd_, SOMAXCONN) < 0)
+    if (::listen(listenFd, SOMAXCONN) < 0)
+    {
+        ::close(listenFd);
         throw std::runtime_error("listen() failed: " + std::string(strerror(errno)));
+    }
 
-    setNonBlocking(listenFd_);
-}
-
-void ChatServer::initEpoll()
-{
-    epollFd_ = ::epoll_create1(0);
-    if (epollFd_ < 0)
-        throw std::runtime_error("epoll_create1() failed: " + std::string(strerror(errno)));
-
-    // 监听 fd 只需要 EPOLLIN，无需 EPOLLONESHOT
-    epollAdd(listenFd_, EPOLLIN | EPOLLET);
-}
-
-int ChatServer::epollAdd(int fd, uint32_t events)
-{
-    epoll_event ev{};
-    ev.data.fd = fd;
-    ev.events  = events;
-    return ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
-}
-
-int ChatServer::epollMod(int fd, uint32_t events)
-{
-    epoll_event ev{};
-    ev.data.fd = fd;
-    ev.events  = events;
-    return ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
-}
-
-int ChatServer::epollDel(int fd)
-{
-    return ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    setNonBlocking(listenFd);
+    return listenFd;
 }
 
-// ────────────────────────────────────────────────────────────────────────────
-// 主事件循环
-// ────────────────────────────────────────────────────────────────────────────
-void ChatServer::start()
+void ChatServer::initReactors()
 {
-    running_ = true;
-
-    // 启动定时器线程（组件 4）
-    timerThread_ = std::thread(&ChatServer::timerLoop, this);
-
-    epoll_event events[MAX_EVENTS];
+    // io_uring 只实现了内联模式，未指定 Sub-Reactor 数量时按 CPU 核数
+    if (options_.backend == IoBackend::Uring && options_.loopNum <= 0)
+        options_.loopNum = std::max(1u, std::thread::hardware_concurrency());
 
-    while (running_)
+    // ── 单 Reactor + 线程池 ──
+    if (options_.loopNum <= 0)
     {
-        int n = ::epoll_wait(epollFd_, events, MAX_EVENTS, -1);
-        if (n < 0)
-        {
-            if (errno == EINTR) continue; // 被信号中断，属正常情况
-            break;
-        }
+        threadpool_ = std::make_unique<Threadpool>(options_.threadNum);
+        baseLoop_   = std::make_unique<EpollLoop>(0, threadpool_.get());
 
-        for (int i = 0; i < n; ++i)
-        {
-            int        fd  = events[i].data.fd;
-            uint32_t   ev  = events[i].events;
-
-            if (fd == listenFd_)
-            {
-                // ── 新连接到来 ──
-                handleNewConnection();
-            }
-            else if (ev & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
-            {
-                // ── 连接异常或对端关闭 ──
-                handleClose(fd);
-            }
-            else if (ev & EPOLLIN)
-            {
-                // ── 有数据可读 → 投递到线程池（组件 3）──
-                handleRead(fd);
-            }
-            else if (ev & EPOLLOUT)
-            {
-                // ── 可写（通常由 Session 内部触发）──
-                handleWrite(fd);
-            }
-        }
+        int listenFd = createListenSocket(false);
+        listenFds_.push_back(listenFd);
+        baseLoop_->setListenFd(listenFd);
+        return;
     }
-}
 
-// ────────────────────────────────────────────────────────────────────────────
-// 2. 连接生命周期管理
-// ────────────────────────────────────────────────────────────────────────────
+    // ── Main / Sub Reactor ──
+    baseLoop_ = std::make_unique<EpollLoop>(0);
+    createSubLoops();
 
-void ChatServer::handleNewConnection()
-{
-    // 在 ET 模式下需要循环 accept 直到 EAGAIN
-    while (true)
+    if (options_.reusePort)
     {
-        sockaddr_in clientAddr{};
-        socklen_t   addrLen = sizeof(clientAddr);
-
-        int connFd = ::accept(listenFd_,
-                              reinterpret_cast<sockaddr*>(&clientAddr),
-                              &addrLen);
-        if (connFd < 0)
+        std::vector<int> fds;
+        for (int i = 0; i < options_.loopNum; ++i)
         {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) break; // 已无待处理连接
-            break;
+            int fd = createListenSocket(true);
+            if (fd < 0) break;
+            fds.push_back(fd);
         }
 
-        setNonBlocking(connFd);
-
-        auto session = std::make_shared<ChatSession>(connFd);
-
+        if (fds.size() == subLoops_.size())
         {
-            std::lock_guard<std::mutex> lock(sessionsMutex_);
-            sessions_[connFd] = session;
+            for (size_t i = 0; i < fds.size(); ++i)
+                subLoops_[i]->setListenFd(fds[i]);
+            listenFds_ = std::move(fds);
+            return;
         }
 
-        // EPOLLONESHOT：同一 fd 的事件每次只触发一次，读完后由 Worker 重新 arm
-        // EPOLLRDHUP  ：内核探测到对端关闭，提前通知主线程
-        epollAdd(connFd, EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLRDHUP);
+        std::cerr << "[ChatServer] SO_REUSEPORT unavailable, fallback to round-robin handoff" << std::endl;
+        for (int fd : fds)
+            ::close(fd);
     }
+
+    // Main Reactor 负责 accept，轮询移交给 Sub-Reactor
+    int listenFd = createListenSocket(false);
+    listenFds_.push_back(listenFd);
+    baseLoop_->setListenFd(listenFd);
+    baseLoop_->setConnectionCallback([this](int connFd) { handleNewConnection(connFd); });
 }
 
-void ChatServer::handleClose(int fd)
+void ChatServer::createSubLoops()
 {
-    std::shared_ptr<ChatSession> session;
-
+    if (options_.backend == IoBackend::Uring)
     {
-        std::lock_guard<std::mutex> lock(sessionsMutex_);
-        auto it = sessions_.find(fd);
-        if (it == sessions_.end()) return; // 已经被处理过，幂等保护
-        session = it->second;
-        sessions_.erase(it);
+        try {
+            for (int i = 0; i < options_.loopNum; ++i)
+                subLoops_.push_back(std::make_unique<UringLoop>(i + 1));
+            return;
+        } catch (const std::exception& e) {
+            std::cerr << "[ChatServer] io_uring unavailable (" << e.what()
+                      << "), fallback to epoll" << std::endl;
+            subLoops_.clear();
+            options_.backend = IoBackend::Epoll;
+        }
     }
 
-    // 通知 UserManager 用户下线
-    if (session->getLogin())
-        UserManager::getInstance().removeSession(session->getUserId());
-
-    // 从 Epoll 中移除（fd 关闭后内核也会自动移除，此处显式处理更稳健）
-    epollDel(fd);
-
-    // 关闭 Session（ChatSession::close() 内部有 isClosed 幂等保护）
-    session->close();
+    for (int i = 0; i < options_.loopNum; ++i)
+        subLoops_.push_back(std::make_unique<EpollLoop>(i + 1));
 }
 
-
-// 3. 任务分发 —— 与 ThreadPool 联动
-
-void ChatServer::handleRead(int fd)
+// ────────────────────────────────────────────────────────────────────────────
+// 主事件循环
+// ────────────────────────────────────────────────────────────────────────────
+void ChatServer::start()
 {
-    std::shared_ptr<ChatSession> session;
-    {
-        std::lock_guard<std::mutex> lock(sessionsMutex_);
-        auto it = sessions_.find(fd);
-        if (it == sessions_.end()) return;
-        session = it->second; // 增加引用计数，Worker 持有期间 session 不会析构
-    }
-
-    threadpool_->enqueue([this, fd, session]() {
-        session->processRead();
+    running_ = true;
 
-        // 尝试重新 arm Epoll：
-        //   若 processRead 内部已关闭 fd（ChatSession::close()），
-        //   epoll_ctl 会返回 -1 / EBADF，此时触发 handleClose 清理。
-        int ret = epollMod(fd, EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLRDHUP);
-        if (ret < 0)
-            handleClose(fd);
-    });
-}
+    // 只有持有监听 fd 的 loop 会 accept，统一挂上即可
+    baseLoop_->setAcceptObserver([this] { onFirstAccept(); });
+    for (auto& loop : subLoops_)
+        loop->setAcceptObserver([this] { onFirstAccept(); });
 
-void ChatServer::handleWrite(int fd)
-{
-    std::shared_ptr<ChatSession> session;
+    for (auto& loop : subLoops_)
     {
-        std::lock_guard<std::mutex> lock(sessionsMutex_);
-        auto it = sessions_.find(fd);
-        if (it == sessions_.end()) return;
-        session = it->second;
+        EventLoop* l = loop.get();
+        loopThreads_.emplace_back([l] { l->loop(); });
     }
 
-    threadpool_->enqueue([this, fd, session]() {
-        session->processWrite();
+    std::cout << "[Startup] accepting on port " << options_.port << " after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - options_.startedAt).count()
+              << "ms" << std::endl;
 
-        // 写完后恢复监听读事件
-        int ret = epollMod(fd, EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLRDHUP);
-        if (ret < 0)
-            handleClose(fd);
-    });
+    baseLoop_->loop();
 }
 
+// ────────────────────────────────────────────────────────────────────────────
+// 2. 连接分发
+// ────────────────────────────────────────────────────────────────────────────
 
-// 4. 定时器任务 —— 扫描心跳超时连接
-
-void ChatServer::timerLoop()
+void ChatServer::handleNewConnection(int connFd)
 {
-    while (running_)
-    {
-        std::this_thread::sleep_for(std::chrono::seconds(TIMER_INTERVAL));
-
-        // 先收集超时的 fd，再在锁外逐一关闭（避免 handleClose 重新获锁时死锁）
-        std::vector<int> toClose;
-        {
-            std::lock_guard<std::mutex> lock(sessionsMutex_);
-            for (auto& [fd, session] : sessions_)
-            {
-                if (session->checkTimeout(HEARTBEAT_TIMEOUT))
-                    toClose.push_back(fd);
-            }
-        }
+    EventLoop* loop = subLoops_[nextLoop_].get();
+    nextLoop_ = (nextLoop_ + 1) % subLoops_.size();
+    loop->addConnection(connFd);
+}
 
-        for (int fd : toClose)
-            handleClose(fd);
-    }
+void ChatServer::onFirstAccept()
+{
+    // 之后每次 accept 只多一次 relaxed 读
+    if (accepted_.load(std::memory_order_relaxed) || accepted_.exchange(true))
+        return;
+
+    std::cout << "[Startup] first connection accepted after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - options_.startedAt).count()
+              << "ms" << std::endl;
 }
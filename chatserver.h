@@ -1,21 +1,41 @@
 #pragma once
 
-#include <sys/epoll.h>
-#include <unordered_map>
+#include <vector>
 #include <memory>
 #include <thread>
-#include <mutex>
 #include <atomic>
+#include <chrono>
 #include "chat/chat.h"
 #include "chat/usermanager.h"
+#include "reactor/eventloop.h"
 #include "threadpool/threadpool.h"
 
-static constexpr int MAX_EVENTS        = 1024;
-static constexpr int HEARTBEAT_TIMEOUT = 30;   // 心跳超时阈值（秒）
-static constexpr int TIMER_INTERVAL    = 1;    // 定时器扫描间隔（秒）
+enum class IoBackend {
+    Epoll,
+    Uring,   // 仅 Sub-Reactor 模式；内核不支持时自动退回 Epoll
+};
+
+struct ServerOptions {
+    int  port      = 8888;
+    int  threadNum = 8;     // 单 Reactor 模式下的 Worker 线程数
+    int  loopNum   = 0;     // Sub-Reactor 数量；0 表示 单 Reactor + 线程池 模式
+    bool reusePort = true;  // 多 Reactor 模式：每个 Sub-Reactor 独立 SO_REUSEPORT 监听，失败则退回轮询分发
+    IoBackend backend = IoBackend::Epoll;
+    OutputLimits outputLimits;  // 每连接发送队列的背压阈值
+    int  presenceWindowMs = 1000;  // 上下线推送的合并窗口，窗口内反复重连只推送最终状态
+    int    offlineFlushMs   = 5;        // 离线消息合并写入的窗口
+    size_t offlineBatchRows = 500;      // 攒满即写入的行数，也是单条 INSERT 的上限
+    size_t offlineQueueRows = 100000;   // 排队上限，超出后直接回复保存失败
+    OfflineAck offlineAck   = OfflineAck::AfterFlush;   // 写入后回执，或入队即回执
+    size_t credentialCacheSize = 65536;   // 已验证凭据缓存的条目数；0 关闭缓存
+    int    credentialTtlSec    = 600;     // 缓存条目有效期，过期后重新查库
+    size_t friendCacheBytes    = 64u << 20;   // 好友关系图中已下线用户与资料的内存预算
+    std::chrono::steady_clock::time_point startedAt = std::chrono::steady_clock::now();   // 启动阶段耗时的起点
+};
 
 class ChatServer {
 public:
+    explicit ChatServer(const ServerOptions& options);
     ChatServer(int port, int threadNum = 8);
     ~ChatServer();
 
@@ -24,35 +44,24 @@ public:
 
 private:
     // ─── 1. 底层网络驱动 ─────────────────────────────────────────
-    void initSocket();                    // 创建监听 Socket
-    void initEpoll();                     // 创建 Epoll 实例，注册 listenFd_
-
-    int  epollAdd(int fd, uint32_t events);
-    int  epollMod(int fd, uint32_t events);
-    int  epollDel(int fd);
-
-    // ─── 2. 连接生命周期管理 ──────────────────────────────────────
-    void handleNewConnection();           // accept 新连接，建立 Session 并注册到 Epoll
-    void handleClose(int fd);             // 断开连接：清理 sessions_、Epoll、UserManager
-
-    // ─── 3. 任务分发（ThreadPool 联动）───────────────────────────
-    void handleRead (int fd);             // 从 Epoll 读事件 → 投递 processRead  到线程池
-    void handleWrite(int fd);             // 从 Epoll 写事件 → 投递 processWrite 到线程池
+    int  createListenSocket(bool reusePort); // 创建监听 Socket，reusePort 时设置失败返回 -1
+    void initReactors();                     // 按模式创建 Main / Sub Reactor
+    void createSubLoops();                   // 按 backend 创建 Sub-Reactor
 
-    // ─── 4. 定时器任务 ────────────────────────────────────────────
-    void timerLoop();                     // 独立线程：每 TIMER_INTERVAL 秒扫描超时连接
+    // ─── 2. 连接分发 ──────────────────────────────────────────────
+    void handleNewConnection(int connFd);    // Main Reactor accept 后轮询移交给 Sub-Reactor
+    void onFirstAccept();                    // 记录从进程启动到接入第一个连接的耗时
 
 private:
-    int  port_;
-    int  listenFd_;
-    int  epollFd_;
+    ServerOptions options_;
     std::atomic<bool> running_;
+    std::atomic<bool> accepted_{false};
 
-    // fd → ChatSession 映射表（需 sessionsMutex_ 保护）
-    std::unordered_map<int, std::shared_ptr<ChatSession>> sessions_;
-    std::mutex sessionsMutex_;
-    
+    std::vector<int> listenFds_;
 
-    std::unique_ptr<Threadpool> threadpool_;
-    std::thread timerThread_;
+    std::unique_ptr<Threadpool> threadpool_;             // 仅 单 Reactor 模式使用
+    std::unique_ptr<EventLoop>  baseLoop_;               // 运行在 start() 调用线程
+    std::vector<std::unique_ptr<EventLoop>> subLoops_;
+    std::vector<std::thread>    loopThreads_;
+    size_t nextLoop_;
 };
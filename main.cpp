@@ -1,7 +1,9 @@
 #include "chatserver.h"
 #include "mysql/sqlConnectionPool.h"
+#include "mysql/dbexecutor.h"
 #include <iostream>
 #include <csignal>
+#include <chrono>
 
 // 全局指针，方便信号处理函数访问
 ChatServer* g_server = nullptr;
@@ -11,6 +13,9 @@ void handleSignal(int sig) {
     if (g_server) {
         std::cout << "\n[System] Signal (" << sig << ") received. Shutting down server..." << std::endl;
 
+        // 先排空数据库任务：完成回调还要投递回仍在运行的 loop
+        DbExecutor::getInstance().stop();
+
         delete g_server; 
         g_server = nullptr;
     }
@@ -24,29 +29,59 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, handleSignal);
     signal(SIGTERM, handleSignal);
 
-    int port = 8888;
-    int threadNum = 8;
+    ServerOptions options;
+
+    if (argc >= 2) options.port      = std::stoi(argv[1]);
+    if (argc >= 3) options.threadNum = std::stoi(argv[2]);
+    if (argc >= 4) options.loopNum   = std::stoi(argv[3]);   // 0 = 单 Reactor + 线程池
+    if (argc >= 5) options.reusePort = std::stoi(argv[4]) != 0;
+    if (argc >= 6 && std::string(argv[5]) == "uring") options.backend = IoBackend::Uring;
 
-    if (argc >= 2) port = std::stoi(argv[1]);
-    if (argc >= 3) threadNum = std::stoi(argv[2]);
+    // 启动各阶段耗时：本阶段 / 自进程启动累计
+    auto phaseAt = options.startedAt;
+    auto logPhase = [&](const char* phase) {
+        auto now = std::chrono::steady_clock::now();
+        std::cout << "[Startup] " << phase << " in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(now - phaseAt).count() << "ms (total "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(now - options.startedAt).count()
+                  << "ms)" << std::endl;
+        phaseAt = now;
+    };
 
     try {
         std::cout << "========================================" << std::endl;
-        std::cout << "   IM Server starting on port: " << port << std::endl;
-        std::cout << "   Worker Threads: " << threadNum << std::endl;
+        std::cout << "   IM Server starting on port: " << options.port << std::endl;
+        if (options.loopNum > 0)
+            std::cout << "   Sub-Reactors: " << options.loopNum
+                      << (options.reusePort ? " (SO_REUSEPORT)" : " (round-robin)")
+                      << (options.backend == IoBackend::Uring ? " io_uring" : " epoll") << std::endl;
+        else
+            std::cout << "   Worker Threads: " << options.threadNum << std::endl;
         std::cout << "========================================" << std::endl;
 
-        // 初始化 MySQL 连接池
+        // 初始化 MySQL 连接池：常驻 4 条，等待持续时扩容到 16 条；
+        // 首条连接就绪即开始监听，其余在后台建好
+        SqlPoolOptions poolOptions;
+        poolOptions.minConn   = 4;
+        poolOptions.maxConn   = 16;
+        poolOptions.readyConn = 1;
         SqlConnPool::getInstance().init(
             "127.0.0.1",   // host
             3306,           // port
             "root",         // user        — 按实际环境修改
             "",       // password    — 按实际环境修改
             "im_server",    // database
-            8               // pool size
+            poolOptions
         );
+        logPhase("sql pool ready");
+
+        // 数据库执行线程：每线程占用一条连接，排队上限之外的请求直接回复繁忙
+        DbExecutor::getInstance().start(8, 1024);
+        logPhase("db executor started");
+
+        g_server = new ChatServer(options);
+        logPhase("server initialized");
 
-        g_server = new ChatServer(port, threadNum);
         g_server->start();
 
     } catch (const std::exception& e) {
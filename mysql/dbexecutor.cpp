@@ -0,0 +1,97 @@
+#include "dbexecutor.h"
+#include <iostream>
+
+// ────────────────────────────────────────────────────────────────────────────
+// 启动 / 停止
+// ────────────────────────────────────────────────────────────────────────────
+void DbExecutor::start(int threadNum, size_t maxQueue)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) return;
+        running_  = true;
+        maxQueue_ = maxQueue;
+    }
+
+    for (int i = 0; i < threadNum; ++i)
+        threads_.emplace_back([this] { run(); });
+
+    std::cout << "[DbExecutor] Started " << threadNum << " threads, queue limit "
+              << maxQueue << std::endl;
+}
+
+void DbExecutor::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cond_.notify_all();
+
+    for (auto& t : threads_)
+        if (t.joinable()) t.join();
+    threads_.clear();
+}
+
+DbExecutor::~DbExecutor()
+{
+    stop();
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 投递
+// ────────────────────────────────────────────────────────────────────────────
+bool DbExecutor::submit(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || queue_.size() >= maxQueue_)
+        {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_.push_back(std::move(task));
+    }
+    cond_.notify_one();
+    return true;
+}
+
+size_t DbExecutor::queued() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 执行线程
+// ────────────────────────────────────────────────────────────────────────────
+void DbExecutor::run()
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+            if (queue_.empty())
+                return; // 已停止且队列排空
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        // 任务内的异常只影响这一个请求，不能带走执行线程乃至整个进程
+        try
+        {
+            task();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "[DbExecutor] task threw: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "[DbExecutor] task threw an unknown exception" << std::endl;
+        }
+    }
+}
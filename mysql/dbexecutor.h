@@ -0,0 +1,64 @@
+#ifndef DB_EXECUTOR_H
+#define DB_EXECUTOR_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "../threadpool/task.h"
+
+/**
+ * DbExecutor — 专用的数据库执行线程（单例）
+ *
+ * 所有阻塞的 MySQL 调用都投递到这里执行，网络线程（loop / Worker）只做 I/O 和内存内路由。
+ *   - 有界队列：submit 从不阻塞，队列满或已停止时返回 false，由调用方立即回复"服务繁忙"，
+ *     登录风暴时积压停留在这里，不会拖住已连接用户的消息投递。
+ *   - 任务自行向 SqlConnPool 借连接；线程数不超过连接池上限时，getConn 至多等到池扩容完成，
+ *     数据库不可用时按借用截止时间返回 nullptr，任务回复"database unavailable"。
+ *   - 结果由任务自己交回发起方（ChatSession::runInStrand），本类不关心回调去向。
+ */
+class DbExecutor {
+public:
+    static DbExecutor& getInstance() {
+        static DbExecutor instance;
+        return instance;
+    }
+
+    DbExecutor(const DbExecutor&) = delete;
+    DbExecutor& operator=(const DbExecutor&) = delete;
+
+    /**
+     * 启动执行线程
+     * @param threadNum 线程数（不超过连接池上限）
+     * @param maxQueue  排队任务上限
+     */
+    void start(int threadNum, size_t maxQueue);
+
+    // 停止接收新任务，执行完已排队的任务后退出（幂等）
+    void stop();
+
+    // 线程安全、非阻塞：队列满或未运行时返回 false
+    bool submit(Task task);
+
+    size_t queued() const;
+    size_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+    DbExecutor() = default;
+    ~DbExecutor();
+
+    void run();
+
+private:
+    std::vector<std::thread> threads_;
+    std::deque<Task>         queue_;
+    size_t                   maxQueue_{0};
+    mutable std::mutex       mutex_;
+    std::condition_variable  cond_;
+    bool                     running_{false};
+    std::atomic<size_t>      rejected_{0};   // 因队列满被拒绝的任务数
+};
+
+#endif
@@ -35,3 +35,32 @@ CREATE TABLE IF NOT EXISTS OfflineMessage (
     send_time   TIMESTAMP       DEFAULT CURRENT_TIMESTAMP   COMMENT '存表时间',
     INDEX idx_to_userid (to_userid)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COMMENT='离线消息表';
+
+-- 4. 群组表（GROUP 是保留字，表名用 ChatGroup）
+CREATE TABLE IF NOT EXISTS ChatGroup (
+    id          INT             PRIMARY KEY AUTO_INCREMENT   COMMENT '群 ID',
+    name        VARCHAR(50)     NOT NULL                    COMMENT '群名称',
+    owner_id    INT             NOT NULL                    COMMENT '创建者 ID',
+    kind        TINYINT         NOT NULL DEFAULT 0          COMMENT '0 群聊（写扩散） / 1 频道（读扩散）',
+    create_time TIMESTAMP       DEFAULT CURRENT_TIMESTAMP   COMMENT '创建时间'
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COMMENT='群组表';
+
+-- 5. 群成员表
+CREATE TABLE IF NOT EXISTS GroupMember (
+    groupid     INT             NOT NULL                    COMMENT '群 ID',
+    userid      INT             NOT NULL                    COMMENT '成员 ID',
+    read_cursor BIGINT          NOT NULL DEFAULT 0          COMMENT '频道：已读到的 ChannelMessage.id',
+    join_time   TIMESTAMP       DEFAULT CURRENT_TIMESTAMP   COMMENT '加入时间',
+    PRIMARY KEY (groupid, userid),
+    INDEX idx_userid (userid)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COMMENT='群成员表';
+
+-- 6. 频道消息日志（只追加，每条消息一行，与成员数无关）
+CREATE TABLE IF NOT EXISTS ChannelMessage (
+    id          BIGINT          PRIMARY KEY AUTO_INCREMENT   COMMENT '消息 ID（游标）',
+    groupid     INT             NOT NULL                    COMMENT '频道 ID',
+    from_userid INT             NOT NULL                    COMMENT '发送者 ID',
+    content     TEXT            NOT NULL                    COMMENT '消息内容',
+    send_time   TIMESTAMP       DEFAULT CURRENT_TIMESTAMP   COMMENT '发送时间',
+    INDEX idx_group_id (groupid, id)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COMMENT='频道消息日志';
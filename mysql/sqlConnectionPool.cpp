@@ -1,116 +1,332 @@
 #include "sqlConnectionPool.h"
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <vector>
+
+namespace
+{
+// 扩容建连失败后暂停扩容的时长，数据库不可用时不让每个等待者都去撞一次连接超时
+constexpr std::chrono::seconds kGrowRetryDelay(1);
+} // namespace
 
 // ────────────────────────────────────────────────────────────────────────────
-// 初始化：预创建 connSize 条 MySQL 长连接
+// 初始化：并行预建 minConn 条 MySQL 长连接，readyConn 条就绪即返回
 // ────────────────────────────────────────────────────────────────────────────
 void SqlConnPool::init(const std::string& host, unsigned int port,
                        const std::string& user, const std::string& pwd,
-                       const std::string& dbName, int connSize)
+                       const std::string& dbName, const SqlPoolOptions& options)
 {
-    assert(connSize > 0);
+    assert(options.minConn > 0 && options.maxConn >= options.minConn);
 
-    for (int i = 0; i < connSize; ++i) {
-        MYSQL* conn = mysql_init(nullptr);
-        if (!conn) {
-            std::cerr << "[SqlConnPool] mysql_init() failed!" << std::endl;
-            continue;
+    host_    = host;
+    port_    = port;
+    user_    = user;
+    pwd_     = pwd;
+    dbName_  = dbName;
+    options_ = options;
+    options_.readyConn = std::max(1, std::min(options_.readyConn, options_.minConn));
+
+    initAt_  = Clock::now();
+    closed_  = false;
+
+    // 每条常驻连接一个线程：建连耗时主要是网络往返与认证，串行时启动耗时随 minConn 线性增长
+    for (int i = 0; i < options_.minConn; ++i)
+        warmers_.emplace_back([this] { warmUp(); });
+    grower_ = std::thread([this] { growLoop(); });
+
+    // 数据库完全不可用时不会有连接就绪，等每个线程都试过一次就返回，不卡住启动
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] {
+        return total_ >= options_.readyConn || attempted_ >= options_.minConn;
+    });
+
+    long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - initAt_).count();
+    std::cout << "[SqlConnPool] Ready with " << total_ << " connections in " << elapsedMs
+              << "ms (min " << options_.minConn << ", max " << options_.maxConn
+              << "), warming up the rest in background" << std::endl;
+
+    if (total_ == 0) {
+        std::cerr << "[SqlConnPool] WARNING: No valid connections created, retrying in background!" << std::endl;
+    }
+}
+
+void SqlConnPool::warmUp()
+{
+    std::chrono::milliseconds delay(options_.retryInitialMs);
+    bool first = true;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // 借用方扩容建的连接同样计入，凑满 minConn 即退出
+        if (closed_ || total_ + creating_ >= options_.minConn) {
+            if (first) {
+                ++attempted_;
+                cond_.notify_all();
+            }
+            return;
+        }
+
+        ++creating_;
+        lock.unlock();
+        SqlConn* conn = connect();
+        lock.lock();
+        --creating_;
+
+        if (first) {
+            ++attempted_;
+            first = false;
+        }
+
+        if (conn && closed_) {
+            lock.unlock();
+            delete conn;
+            return;
+        }
+
+        if (conn) {
+            idle_.push_back(Idle{conn, Clock::now()});
+            ++total_;
+            if (total_ == options_.minConn) {
+                long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - initAt_).count();
+                std::cout << "[SqlConnPool] Warm-up complete: " << total_ << " connections in "
+                          << elapsedMs << "ms" << std::endl;
+            }
+            cond_.notify_all();   // 唤醒 init 与等待连接的借用方
+            return;
         }
 
-        // 设置连接超时 & 自动重连
-        unsigned int timeout = 10;
-        bool reconnect = true;
-        mysql_options(conn, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
-        mysql_options(conn, MYSQL_OPT_RECONNECT, &reconnect);
-
-        // 设置字符集为 utf8mb4
-        mysql_options(conn, MYSQL_SET_CHARSET_NAME, "utf8mb4");
-
-        conn = mysql_real_connect(conn,
-                                  host.c_str(), user.c_str(), pwd.c_str(),
-                                  dbName.c_str(), port, nullptr, 0);
-        if (!conn) {
-            std::cerr << "[SqlConnPool] mysql_real_connect() failed: "
-                      << mysql_error(conn) << std::endl;
+        ++connectFailures_;
+        cond_.notify_all();
+
+        // 退避等待期间池关闭则立即退出
+        if (cond_.wait_for(lock, delay, [this] { return closed_.load(); }))
+            return;
+        delay = std::min(delay * 2, std::chrono::milliseconds(options_.retryMaxMs));
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 扩容线程：借用方只提出请求，建连（最长一次连接超时）不占用任何借用方的截止时间
+// ────────────────────────────────────────────────────────────────────────────
+void SqlConnPool::growLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        growCond_.wait(lock, [this] { return closed_ || growRequested_; });
+        if (closed_)
+            return;
+        growRequested_ = false;
+
+        // 请求发出后已有连接归还、或已到上限：不必再建
+        if (!idle_.empty() || total_ + creating_ >= options_.maxConn || Clock::now() < growRetryAt_)
+            continue;
+
+        ++creating_;
+        lock.unlock();
+        SqlConn* fresh = connect();
+        lock.lock();
+        --creating_;
+
+        if (fresh && closed_) {
+            lock.unlock();
+            delete fresh;
+            return;
+        }
+        if (fresh) {
+            idle_.push_back(Idle{fresh, Clock::now()});
+            ++total_;
+            ++grown_;
+            cond_.notify_one();
             continue;
         }
+        ++connectFailures_;
+        growRetryAt_ = Clock::now() + kGrowRetryDelay;
+        cond_.notify_all();   // 等待者据此改为睡到截止时间或重试时刻
+    }
+}
 
-        connQueue_.push(conn);
+SqlConn* SqlConnPool::connect()
+{
+    MYSQL* conn = mysql_init(nullptr);
+    if (!conn) {
+        std::cerr << "[SqlConnPool] mysql_init() failed!" << std::endl;
+        return nullptr;
     }
 
-    maxConn_ = static_cast<int>(connQueue_.size());
-    closed_  = false;
+    // 设置连接超时 & 自动重连
+    unsigned int timeout = 10;
+    bool reconnect = true;
+    mysql_options(conn, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    mysql_options(conn, MYSQL_OPT_RECONNECT, &reconnect);
 
-    std::cout << "[SqlConnPool] Initialized with " << maxConn_
-              << " connections (requested " << connSize << ")" << std::endl;
+    // 设置字符集为 utf8mb4
+    mysql_options(conn, MYSQL_SET_CHARSET_NAME, "utf8mb4");
 
-    if (maxConn_ == 0) {
-        std::cerr << "[SqlConnPool] WARNING: No valid connections created!" << std::endl;
+    if (!mysql_real_connect(conn, host_.c_str(), user_.c_str(), pwd_.c_str(),
+                            dbName_.c_str(), port_, nullptr, 0)) {
+        std::cerr << "[SqlConnPool] mysql_real_connect() failed: "
+                  << mysql_error(conn) << std::endl;
+        mysql_close(conn);
+        return nullptr;
     }
+
+    // 预处理语句随连接一起准备好，请求路径上只剩绑定参数 + 执行
+    SqlConn* sqlConn = new SqlConn(conn);
+    sqlConn->prepareAll();
+    return sqlConn;
 }
 
 // ────────────────────────────────────────────────────────────────────────────
 // 获取连接 — RAII（shared_ptr + 自定义删除器）
 // ────────────────────────────────────────────────────────────────────────────
-std::shared_ptr<MYSQL> SqlConnPool::getConn()
+std::shared_ptr<SqlConn> SqlConnPool::getConn()
+{
+    return getConn(std::chrono::milliseconds(options_.checkoutTimeoutMs));
+}
+
+std::shared_ptr<SqlConn> SqlConnPool::getConn(std::chrono::milliseconds timeout)
 {
     if (closed_) {
         return nullptr;
     }
 
-    MYSQL* conn = nullptr;
+    Clock::time_point start    = Clock::now();
+    Clock::time_point deadline = start + timeout;
+    Clock::time_point growAt   = start + std::chrono::milliseconds(options_.growAfterMs);
+
+    SqlConn* conn = nullptr;
+    bool needPing = false;
     {
         std::unique_lock<std::mutex> lock(mutex_);
-        cond_.wait(lock, [this] { return !connQueue_.empty() || closed_; });
+        while (true) {
+            if (closed_) {
+                return nullptr;
+            }
+
+            Clock::time_point now = Clock::now();
 
-        if (closed_ || connQueue_.empty()) {
-            return nullptr;
+            // 后进先出：最近归还的连接最热，也最不可能已被服务端断开
+            if (!idle_.empty()) {
+                conn = idle_.back().conn;
+                needPing = now - idle_.back().since >= std::chrono::milliseconds(options_.idlePingMs);
+                idle_.pop_back();
+                break;
+            }
+
+            // 等得足够久、还有余量：请扩容线程建一条，自己继续等到截止时间
+            // （建连最长要一次连接超时，远超借用的截止时间，不能在借用方线程上做）
+            bool canGrow = total_ + creating_ < options_.maxConn && !growRequested_;
+            if (canGrow && now >= growAt && now >= growRetryAt_) {
+                growRequested_ = true;
+                growCond_.notify_one();
+                canGrow = false;
+            }
+
+            if (now >= deadline) {
+                ++timeouts_;
+                return nullptr;
+            }
+
+            // 还能请求扩容时只睡到扩容时刻，否则睡到截止时间（新连接建好或有归还时会被唤醒）
+            Clock::time_point wake = deadline;
+            if (canGrow)
+                wake = std::min(wake, std::max(growAt, growRetryAt_));
+            cond_.wait_until(lock, wake);
         }
 
-        conn = connQueue_.front();
-        connQueue_.pop();
+        uint64_t waitUs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        size_t bucket = std::upper_bound(kWaitBucketsUs.begin(), kWaitBucketsUs.end(), waitUs) - kWaitBucketsUs.begin();
+        ++waitHistogram_[bucket];
+        ++checkouts_;
+        maxWaitUs_ = std::max(maxWaitUs_, waitUs);
     }
 
-    // 检查连接是否还活着，断了就重连
-    if (mysql_ping(conn) != 0) {
-        std::cerr << "[SqlConnPool] Connection lost, reconnecting..." << std::endl;
-        // mysql_ping 在开启 MYSQL_OPT_RECONNECT 后会自动重连
+    // 只对空闲过久的连接检活：刚用过的连接省掉一次往返，
+    // 真断了的由 SqlStatement 在执行出错时 ping 重连后重试
+    if (needPing) {
+        pings_.fetch_add(1, std::memory_order_relaxed);
+        if (mysql_ping(conn->mysql()) != 0) {
+            pingFailures_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "[SqlConnPool] Connection lost, reconnecting..." << std::endl;
+            // mysql_ping 在开启 MYSQL_OPT_RECONNECT 后会自动重连
+        }
     }
+    // 重连后旧的语句句柄失效，需要重新 prepare
+    conn->checkReconnect();
 
+    return wrap(conn);
+}
+
+std::shared_ptr<SqlConn> SqlConnPool::wrap(SqlConn* conn)
+{
     // 返回 shared_ptr，自定义删除器在析构时归还连接
-    return std::shared_ptr<MYSQL>(conn, [this](MYSQL* c) {
+    return std::shared_ptr<SqlConn>(conn, [this](SqlConn* c) {
         this->freeConn(c);
     });
 }
 
 // ────────────────────────────────────────────────────────────────────────────
-// 归还连接
+// 归还连接（顺带回收冷端空闲过久的连接）
 // ────────────────────────────────────────────────────────────────────────────
-void SqlConnPool::freeConn(MYSQL* conn)
+void SqlConnPool::freeConn(SqlConn* conn)
 {
     if (!conn) return;
 
     if (closed_) {
         // 池已关闭，直接释放
-        mysql_close(conn);
+        delete conn;
         return;
     }
 
+    std::vector<SqlConn*> expired;
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        connQueue_.push(conn);
+        Clock::time_point now = Clock::now();
+        idle_.push_back(Idle{conn, now});
+
+        while (total_ > options_.minConn && !idle_.empty() &&
+               now - idle_.front().since >= std::chrono::milliseconds(options_.idleCloseMs)) {
+            expired.push_back(idle_.front().conn);
+            idle_.pop_front();
+            --total_;
+            ++shrunk_;
+        }
     }
     cond_.notify_one();
+
+    // mysql_close 会与服务端交互，放到锁外
+    for (SqlConn* c : expired)
+        delete c;
 }
 
 // ────────────────────────────────────────────────────────────────────────────
-// 获取空闲数
+// 获取空闲数 / 统计
 // ────────────────────────────────────────────────────────────────────────────
 int SqlConnPool::getFreeCount()
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    return static_cast<int>(connQueue_.size());
+    return static_cast<int>(idle_.size());
+}
+
+SqlConnPool::Stats SqlConnPool::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.total           = total_;
+    s.idle            = static_cast<int>(idle_.size());
+    s.inUse           = total_ - s.idle;
+    s.checkouts       = checkouts_;
+    s.timeouts        = timeouts_;
+    s.connectFailures = connectFailures_;
+    s.grown           = grown_;
+    s.shrunk          = shrunk_;
+    s.pings           = pings_.load(std::memory_order_relaxed);
+    s.pingFailures    = pingFailures_.load(std::memory_order_relaxed);
+    s.maxWaitUs       = maxWaitUs_;
+    s.waitHistogram   = waitHistogram_;
+    return s;
 }
 
 // ────────────────────────────────────────────────────────────────────────────
@@ -120,13 +336,32 @@ void SqlConnPool::closePool()
 {
     if (closed_.exchange(true)) return; // 幂等
 
-    cond_.notify_all(); // 唤醒所有等待者
+    {
+        // 在锁内通知，避免预热线程检查完 closed_ 尚未进入等待时错过唤醒
+        std::lock_guard<std::mutex> lock(mutex_);
+        cond_.notify_all(); // 唤醒所有等待者与退避中的预热线程
+        growCond_.notify_all();
+    }
+
+    // 正在建连的预热 / 扩容线程最多再等一次连接超时，建好的连接由它自己释放
+    for (auto& t : warmers_)
+        if (t.joinable()) t.join();
+    warmers_.clear();
+    if (grower_.joinable())
+        grower_.join();
+
+    Stats s = stats();
+    std::cout << "[SqlConnPool] " << s.checkouts << " checkouts, " << s.timeouts << " timeouts, "
+              << s.grown << " grown, " << s.shrunk << " shrunk, " << s.pings << " pings, max wait "
+              << s.maxWaitUs << "us, wait histogram (<=100us/1ms/10ms/100ms/1s/more):";
+    for (uint64_t n : s.waitHistogram)
+        std::cout << ' ' << n;
+    std::cout << std::endl;
 
     std::lock_guard<std::mutex> lock(mutex_);
-    while (!connQueue_.empty()) {
-        MYSQL* conn = connQueue_.front();
-        connQueue_.pop();
-        mysql_close(conn);
+    while (!idle_.empty()) {
+        delete idle_.front().conn;
+        idle_.pop_front();
     }
 
     std::cout << "[SqlConnPool] All connections closed." << std::endl;
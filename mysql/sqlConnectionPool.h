@@ -2,24 +2,69 @@
 #define SQL_CONNECTION_POOL_H
 
 #include <mysql/mysql.h>
-#include <queue>
+#include <array>
+#include <chrono>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 #include <string>
 #include <memory>
 #include <atomic>
+#include <thread>
+#include <vector>
+#include "sqlStatement.h"
+
+// 连接池伸缩与借用策略
+struct SqlPoolOptions {
+    int minConn           = 4;       // 常驻连接数，启动时预建，空闲回收不低于此数
+    int maxConn           = 16;      // 连接数上限
+    int checkoutTimeoutMs = 1000;    // getConn 默认的等待上限，超时返回 nullptr
+    int growAfterMs       = 5;       // 借用方等待超过此时长且未达上限时请求后台新建一条连接
+    int idlePingMs        = 30000;   // 空闲超过此时长的连接借出前才 mysql_ping
+    int idleCloseMs       = 60000;   // 超出 minConn 的连接空闲超过此时长后关闭
+    int readyConn         = 1;       // init 等到这么多条连接就绪即返回，其余 minConn 在后台补齐
+    int retryInitialMs    = 200;     // 后台建连失败后的首次重试间隔，之后逐次翻倍
+    int retryMaxMs        = 10000;   // 重试间隔上限
+};
 
 /**
  * SqlConnPool — MySQL 连接池（单例）
  *
  * 设计目标：
- *   - 预创建固定数量的 MySQL 长连接，避免每次业务请求都走"建连 → 查询 → 断连"。
+ *   - 复用 MySQL 长连接，避免每次业务请求都走"建连 → 查询 → 断连"。
  *   - 通过 RAII (shared_ptr + custom deleter) 向 Worker 线程提供连接，
  *     使用完毕后自动归还，杜绝忘记归还的风险。
  *   - 所有接口线程安全，可在 ThreadPool 的多个 Worker 中并发使用。
+ *   - 每条连接自带一组预处理语句（见 sqlStatement.h），建连时 prepare 一次，
+ *     业务代码按 StmtId 取用并绑定参数，不再拼接 SQL 字符串。
+ *
+ * 预热：init 为 minConn 条连接各起一个线程并行建连，readyConn 条就绪（或每条都至少试过一次）
+ * 即返回，服务可以先开始监听；其余连接在后台补齐，失败按指数退避重试，直到池关闭。
+ *
+ * 伸缩：常驻 minConn 条；借用方持续等待（growAfterMs）时请扩容线程新建一条放入空闲队列，
+ * 自己继续等到截止时间，建连耗时（最长一次连接超时）不会拖过 checkoutTimeoutMs；最多到 maxConn。空闲连接按后进先出借出，冷端的连接自然老化，超过 idleCloseMs 后
+ * 在归还路径上关闭，直到回到 minConn。
  */
 class SqlConnPool {
 public:
+    // 借用等待时间直方图的桶上界（微秒），最后一个桶收纳更长的等待
+    static constexpr std::array<uint64_t, 5> kWaitBucketsUs = {100, 1000, 10000, 100000, 1000000};
+
+    struct Stats {
+        int      total;           // 已建立的连接（空闲 + 借出）
+        int      idle;
+        int      inUse;
+        uint64_t checkouts;       // 成功借出次数
+        uint64_t timeouts;        // 超过截止时间仍未借到
+        uint64_t connectFailures; // 启动或扩容时建连失败
+        uint64_t grown;           // 扩容新建的连接数
+        uint64_t shrunk;          // 空闲回收关闭的连接数
+        uint64_t pings;           // 借出前因空闲过久执行的 mysql_ping
+        uint64_t pingFailures;
+        uint64_t maxWaitUs;
+        std::array<uint64_t, kWaitBucketsUs.size() + 1> waitHistogram;   // 成功借出的等待时间分布
+    };
+
     static SqlConnPool& getInstance() {
         static SqlConnPool instance;
         return instance;
@@ -31,47 +76,92 @@ public:
 
     /**
      * 初始化连接池
-     * @param host     MySQL 主机地址
-     * @param port     MySQL 端口
-     * @param user     用户名
-     * @param pwd      密码
-     * @param dbName   数据库名
-     * @param connSize 连接池大小（默认 8）
+     * @param host    MySQL 主机地址
+     * @param port    MySQL 端口
+     * @param user    用户名
+     * @param pwd     密码
+     * @param dbName  数据库名
+     * @param options 伸缩与借用策略
      */
     void init(const std::string& host, unsigned int port,
               const std::string& user, const std::string& pwd,
-              const std::string& dbName, int connSize = 8);
+              const std::string& dbName, const SqlPoolOptions& options = SqlPoolOptions());
 
     /**
      * 获取一个数据库连接（RAII 方式）
-     * 返回 shared_ptr<MYSQL>，析构时自动归还连接到池中。
-     * 如果池中无空闲连接则阻塞等待。
+     * 返回 shared_ptr<SqlConn>，析构时自动归还连接到池中。
+     * 无空闲连接时等待，超过 timeout（缺省为 checkoutTimeoutMs）或池已关闭时返回 nullptr。
      */
-    std::shared_ptr<MYSQL> getConn();
+    std::shared_ptr<SqlConn> getConn();
+    std::shared_ptr<SqlConn> getConn(std::chrono::milliseconds timeout);
 
     /**
      * 获取当前空闲连接数
      */
     int getFreeCount();
 
+    Stats stats();
+
     /**
      * 关闭连接池，释放所有连接
      */
     void closePool();
 
 private:
+    using Clock = std::chrono::steady_clock;
+
     SqlConnPool() = default;
     ~SqlConnPool();
 
+    // 按 init 保存的参数新建一条连接并 prepare 全部语句；失败返回 nullptr
+    SqlConn* connect();
+
+    // 预热线程：建一条常驻连接，失败则退避重试，直到成功、池已满 minConn 或池关闭
+    void warmUp();
+
+    // 扩容线程：等待借用方的请求，新建一条连接放入空闲队列
+    void growLoop();
+
     // 将连接归还到池中（由 shared_ptr 的自定义删除器调用）
-    void freeConn(MYSQL* conn);
+    void freeConn(SqlConn* conn);
+
+    std::shared_ptr<SqlConn> wrap(SqlConn* conn);
 
 private:
-    std::queue<MYSQL*>      connQueue_;     // 空闲连接队列
-    std::mutex              mutex_;         // 保护队列
+    struct Idle {
+        SqlConn*          conn;
+        Clock::time_point since;   // 归还时间
+    };
+
+    std::string  host_, user_, pwd_, dbName_;
+    unsigned int port_{0};
+    SqlPoolOptions options_;
+
+    std::deque<Idle>        idle_;          // 空闲连接，back 最近归还
+    std::mutex              mutex_;         // 保护以下所有字段
     std::condition_variable cond_;          // 等待空闲连接
     std::atomic<bool>       closed_{true};  // 连接池是否已关闭
-    int                     maxConn_{0};    // 最大连接数
+    int                     total_{0};      // 已建立的连接数
+    int                     creating_{0};   // 正在扩容建连的数量，计入上限
+    Clock::time_point       growRetryAt_{}; // 扩容建连失败后，此时刻之前不再尝试
+    bool                    growRequested_{false}; // 有借用方等待扩容，尚未被扩容线程取走
+    std::condition_variable growCond_;      // 唤醒扩容线程
+
+    std::vector<std::thread> warmers_;      // 预热线程，closePool 时回收
+    std::thread             grower_;        // 扩容线程，closePool 时回收
+    int                     attempted_{0};  // 已完成首次建连尝试的预热线程数
+    Clock::time_point       initAt_{};      // init 开始时刻，用于记录预热耗时
+
+    // 统计（mutex_ 保护）
+    uint64_t checkouts_{0};
+    uint64_t timeouts_{0};
+    uint64_t connectFailures_{0};
+    uint64_t grown_{0};
+    uint64_t shrunk_{0};
+    uint64_t maxWaitUs_{0};
+    std::array<uint64_t, kWaitBucketsUs.size() + 1> waitHistogram_{};
+    std::atomic<uint64_t> pings_{0};
+    std::atomic<uint64_t> pingFailures_{0};
 };
 
 #endif
@@ -0,0 +1,284 @@
+#include "sqlStatement.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr unsigned long kInitialColumnSize = 64;   // 超出时按实际长度扩容
+
+} // namespace
+
+// ────────────────────────────────────────────────────────────────────────────
+// SqlStatement
+// ────────────────────────────────────────────────────────────────────────────
+SqlStatement::SqlStatement(MYSQL *conn, std::string_view sql, bool idempotent)
+    : conn_(conn), sql_(sql), stmt_(nullptr), idempotent_(idempotent), hasResult_(false)
+{
+}
+
+SqlStatement::~SqlStatement()
+{
+    if (stmt_)
+        mysql_stmt_close(stmt_);
+}
+
+bool SqlStatement::prepare()
+{
+    if (stmt_)
+    {
+        mysql_stmt_close(stmt_);
+        stmt_ = nullptr;
+    }
+    hasResult_ = false;
+    columns_.clear();
+    resultBinds_.clear();
+
+    stmt_ = mysql_stmt_init(conn_);
+    if (!stmt_)
+    {
+        error_ = "mysql_stmt_init failed";
+        return false;
+    }
+    if (mysql_stmt_prepare(stmt_, sql_.data(), sql_.size()) != 0)
+    {
+        error_ = mysql_stmt_error(stmt_);
+        std::cerr << "[SqlStatement] prepare failed: " << error_ << " | " << sql_ << std::endl;
+        mysql_stmt_close(stmt_);
+        stmt_ = nullptr;
+        return false;
+    }
+
+    // 结果列统一按字符串接收，数值列在读取时再转换
+    unsigned int fields = mysql_stmt_field_count(stmt_);
+    columns_.resize(fields);
+    resultBinds_.assign(fields, MYSQL_BIND{});
+    for (Column &col : columns_)
+        col.buffer.resize(kInitialColumnSize);
+    return true;
+}
+
+void SqlStatement::bindText(size_t i, const char *data, size_t size)
+{
+    Param &p = params_[i];
+    p.isText = true;
+    p.text   = data ? data : "";
+    p.length = static_cast<unsigned long>(size);
+}
+
+bool SqlStatement::run()
+{
+    error_.clear();
+    if (stmt_ || prepare())
+    {
+        if (executeOnce())
+            return true;
+        if (!retryable(mysql_stmt_errno(stmt_)))
+            return false;
+    }
+    // prepare 失败时语句还没发出，总可以重试
+
+    // 连接可能已断开：ping 触发自动重连，再重新 prepare 一次
+    mysql_ping(conn_);
+    return prepare() && executeOnce();
+}
+
+bool SqlStatement::retryable(unsigned int err) const
+{
+    switch (err)
+    {
+    // 句柄已不可用（服务端丢弃了句柄、表结构变化），语句确定没有执行
+    case 2030:   // CR_NO_PREPARE_STMT
+    case 1243:   // ER_UNKNOWN_STMT_HANDLER
+    case 1615:   // ER_NEED_REPREPARE
+        return true;
+    // 断线：请求可能已在服务端执行，只有幂等语句可以重来
+    case 2006:   // CR_SERVER_GONE_ERROR
+    case 2013:   // CR_SERVER_LOST
+        return idempotent_;
+    default:
+        return false;
+    }
+}
+
+bool SqlStatement::executeOnce()
+{
+    freeResult();
+
+    if (mysql_stmt_param_count(stmt_) != params_.size())
+    {
+        error_ = "parameter count mismatch";
+        std::cerr << "[SqlStatement] " << error_ << ": " << sql_ << std::endl;
+        return false;
+    }
+
+    paramBinds_.assign(params_.size(), MYSQL_BIND{});
+    for (size_t i = 0; i < params_.size(); ++i)
+    {
+        Param &p = params_[i];
+        MYSQL_BIND &b = paramBinds_[i];
+        if (p.isText)
+        {
+            b.buffer_type   = MYSQL_TYPE_STRING;
+            b.buffer        = const_cast<char *>(p.text);
+            b.buffer_length = p.length;
+            b.length        = &p.length;
+        }
+        else
+        {
+            b.buffer_type = MYSQL_TYPE_LONGLONG;
+            b.buffer      = &p.integer;
+        }
+    }
+
+    if (!paramBinds_.empty() && mysql_stmt_bind_param(stmt_, paramBinds_.data()))
+        return false;
+    if (mysql_stmt_execute(stmt_) != 0)
+        return false;
+
+    if (columns_.empty())
+        return true;
+
+    // 结果集整体缓存到客户端，释放服务端游标；之后的 fetch 不再往返
+    if (mysql_stmt_store_result(stmt_) != 0)
+        return false;
+    hasResult_ = true;
+    return bindResults();
+}
+
+bool SqlStatement::bindResults()
+{
+    for (size_t i = 0; i < columns_.size(); ++i)
+    {
+        Column &col = columns_[i];
+        MYSQL_BIND &b = resultBinds_[i];
+        b = MYSQL_BIND{};
+        b.buffer_type   = MYSQL_TYPE_STRING;
+        b.buffer        = &col.buffer[0];
+        b.buffer_length = static_cast<unsigned long>(col.buffer.size());
+        b.length        = &col.length;
+        b.is_null       = &col.isNull;
+        b.error         = &col.error;
+    }
+    return !mysql_stmt_bind_result(stmt_, resultBinds_.data());
+}
+
+bool SqlStatement::fetch()
+{
+    if (!hasResult_)
+        return false;
+
+    int rc = mysql_stmt_fetch(stmt_);
+    if (rc == MYSQL_NO_DATA || rc == 1)
+    {
+        freeResult();
+        return false;
+    }
+    if (rc != MYSQL_DATA_TRUNCATED)
+        return true;
+
+    // 有列超出缓冲：按实际长度扩容后单独重取该列，并为后续行重新绑定
+    for (size_t i = 0; i < columns_.size(); ++i)
+    {
+        Column &col = columns_[i];
+        if (col.isNull || col.length <= col.buffer.size())
+            continue;
+
+        col.buffer.resize(col.length);
+        MYSQL_BIND b{};
+        b.buffer_type   = MYSQL_TYPE_STRING;
+        b.buffer        = &col.buffer[0];
+        b.buffer_length = col.length;
+        b.length        = &col.length;
+        b.is_null       = &col.isNull;
+        b.error         = &col.error;
+        if (mysql_stmt_fetch_column(stmt_, &b, static_cast<unsigned int>(i), 0) != 0)
+        {
+            freeResult();
+            return false;
+        }
+    }
+    return bindResults();
+}
+
+int SqlStatement::getInt(size_t col) const
+{
+    return static_cast<int>(getInt64(col));
+}
+
+int64_t SqlStatement::getInt64(size_t col) const
+{
+    const Column &c = columns_[col];
+    if (c.isNull)
+        return 0;
+    // 列缓冲不以 '\0' 结尾，数字最多 20 位，拷到栈上转换
+    char digits[32];
+    size_t n = std::min<size_t>(c.length, sizeof(digits) - 1);
+    memcpy(digits, c.buffer.data(), n);
+    digits[n] = '\0';
+    return std::strtoll(digits, nullptr, 10);
+}
+
+std::string SqlStatement::getString(size_t col) const
+{
+    const Column &c = columns_[col];
+    return c.isNull ? std::string() : std::string(c.buffer.data(), c.length);
+}
+
+uint64_t SqlStatement::affectedRows() const
+{
+    return stmt_ ? mysql_stmt_affected_rows(stmt_) : 0;
+}
+
+uint64_t SqlStatement::insertId() const
+{
+    return stmt_ ? mysql_stmt_insert_id(stmt_) : 0;
+}
+
+const char *SqlStatement::error() const
+{
+    if (!error_.empty())
+        return error_.c_str();
+    return stmt_ ? mysql_stmt_error(stmt_) : mysql_error(conn_);
+}
+
+void SqlStatement::freeResult()
+{
+    if (hasResult_)
+    {
+        mysql_stmt_free_result(stmt_);
+        hasResult_ = false;
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// SqlConn
+// ────────────────────────────────────────────────────────────────────────────
+SqlConn::SqlConn(MYSQL *mysql)
+    : mysql_(mysql), threadId_(0)
+{
+    for (size_t i = 0; i < kStmtCount; ++i)
+        stmts_[i] = std::make_unique<SqlStatement>(mysql_, kStatementSql[i], stmtIdempotent(static_cast<StmtId>(i)));
+}
+
+SqlConn::~SqlConn()
+{
+    for (auto &stmt : stmts_)
+        stmt.reset();
+    mysql_close(mysql_);
+}
+
+void SqlConn::prepareAll()
+{
+    threadId_ = mysql_thread_id(mysql_);
+    for (auto &stmt : stmts_)
+        stmt->prepare();   // 失败已记录日志，首次执行时会再尝试
+}
+
+void SqlConn::checkReconnect()
+{
+    // 自动重连后服务端会话已换新，旧的语句句柄全部失效
+    if (mysql_thread_id(mysql_) != threadId_)
+        prepareAll();
+}
@@ -0,0 +1,198 @@
+#ifndef SQL_STATEMENT_H
+#define SQL_STATEMENT_H
+
+#include <mysql/mysql.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * StmtId — 业务语句登记表
+ *
+ * 固定形状的 SQL 都在这里登记，连接建立时逐条 prepare 一次，之后只传参数。
+ * 新增语句：在枚举中加一项，在 kStatementSql 同一位置写上 SQL。
+ * 行数可变的语句（离线消息的多行 INSERT、CASE 批量 UPDATE）仍按文本执行。
+ */
+enum class StmtId : uint8_t
+{
+    Login,              // username, password            → id, nickname
+    UserByName,         // username                      → id
+    UserInsert,         // username, password
+    UserById,           // id                            → id, username, nickname
+    FriendIds,          // userid                        → friendid
+    FriendInsert,       // a, b, b, a（已是好友时影响 0 行）
+    FriendList,         // userid                        → id, username, nickname
+    OfflinePage,        // to_userid, after, limit       → id, content
+    OfflineAck,         // to_userid, upto（删除 id <= upto 的行）
+    GroupInsert,        // name, owner_id, kind
+    GroupKind,          // id                            → kind
+    GroupMemberAdd,     // groupid, userid（已存在时影响 0 行）
+    GroupMemberDelete,  // groupid, userid
+    GroupMembers,       // groupid                       → userid
+    ChannelInsert,      // groupid, from_userid, content
+    ChannelPage,        // groupid, after, limit         → id, from_userid, content
+    ChannelCursors,     // userid                        → groupid, read_cursor
+
+    Count
+};
+
+constexpr size_t kStmtCount = static_cast<size_t>(StmtId::Count);
+
+inline constexpr std::string_view kStatementSql[] = {
+    "SELECT id, nickname FROM User WHERE username=? AND password=?",
+    "SELECT id FROM User WHERE username=?",
+    "INSERT INTO User(username, password) VALUES(?, ?)",
+    "SELECT id, username, nickname FROM User WHERE id=?",
+    "SELECT friendid FROM Friend WHERE userid=?",
+    "INSERT IGNORE INTO Friend(userid, friendid) VALUES(?, ?), (?, ?)",
+    "SELECT u.id, u.username, u.nickname FROM Friend f JOIN User u ON f.friendid = u.id WHERE f.userid = ?",
+    "SELECT id, content FROM OfflineMessage WHERE to_userid=? AND id>? ORDER BY id LIMIT ?",
+    "DELETE FROM OfflineMessage WHERE to_userid=? AND id<=?",
+    "INSERT INTO ChatGroup(name, owner_id, kind) VALUES(?, ?, ?)",
+    "SELECT kind FROM ChatGroup WHERE id=?",
+    "INSERT IGNORE INTO GroupMember(groupid, userid) VALUES(?, ?)",
+    "DELETE FROM GroupMember WHERE groupid=? AND userid=?",
+    "SELECT userid FROM GroupMember WHERE groupid=?",
+    "INSERT INTO ChannelMessage(groupid, from_userid, content) VALUES(?, ?, ?)",
+    "SELECT id, from_userid, content FROM ChannelMessage WHERE groupid=? AND id>? ORDER BY id LIMIT ?",
+    "SELECT m.groupid, m.read_cursor FROM GroupMember m JOIN ChatGroup g ON g.id = m.groupid "
+    "WHERE m.userid=? AND g.kind=1",
+};
+
+static_assert(sizeof(kStatementSql) / sizeof(kStatementSql[0]) == kStmtCount,
+              "every StmtId needs its SQL");
+
+// 执行中途断线时服务端可能已经提交，重复执行会多写一行（或把注册误报为重名）。
+// 这些语句只在确定未执行时重试，其余语句断线后重连再执行一次结果不变
+constexpr bool stmtIdempotent(StmtId id)
+{
+    switch (id)
+    {
+    case StmtId::UserInsert:
+    case StmtId::GroupInsert:
+    case StmtId::ChannelInsert:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/**
+ * SqlStatement — 一条预处理语句（MYSQL_STMT）的类型化封装
+ *
+ *   auto& stmt = conn->stmt(StmtId::Login);
+ *   if (!stmt.execute(user, pwd)) ...;      // 按参数类型绑定，字符串不转义、不拷贝
+ *   while (stmt.fetch()) stmt.getInt(0);    // 结果逐行读取，超长列自动扩容重取
+ *
+ * 只能在借出该连接的线程上使用；连接断开重连后语句句柄失效，execute 会重新
+ * prepare 并重试一次。非幂等语句在执行中断线（结果未知）时不重试，直接返回失败。
+ */
+class SqlStatement
+{
+public:
+    SqlStatement(MYSQL *conn, std::string_view sql, bool idempotent = true);
+    ~SqlStatement();
+
+    SqlStatement(const SqlStatement &) = delete;
+    SqlStatement &operator=(const SqlStatement &) = delete;
+
+    bool prepare();   // 关闭旧句柄后重新 prepare
+
+    // 绑定参数并执行；有结果集时缓存到客户端，之后用 fetch 逐行读取
+    template <typename... Args>
+    bool execute(const Args &...args)
+    {
+        params_.assign(sizeof...(Args), Param{});
+        size_t i = 0;
+        (bindParam(i++, args), ...);
+        return run();
+    }
+
+    bool fetch();   // 下一行；没有更多行或出错时返回 false
+
+    bool        isNull(size_t col) const { return columns_[col].isNull; }
+    int         getInt(size_t col) const;
+    int64_t     getInt64(size_t col) const;
+    std::string getString(size_t col) const;
+
+    uint64_t    affectedRows() const;
+    uint64_t    insertId() const;
+    const char *error() const;
+
+private:
+    struct Param
+    {
+        long long   integer = 0;
+        const char *text    = nullptr;   // 指向调用方的字符串，execute 期间有效
+        unsigned long length = 0;
+        bool        isText  = false;
+    };
+
+    struct Column
+    {
+        std::string   buffer;
+        unsigned long length = 0;
+        bool          isNull = false;
+        bool          error  = false;
+    };
+
+    void bindParam(size_t i, int value)                { params_[i].integer = value; }
+    void bindParam(size_t i, long long value)          { params_[i].integer = value; }
+    void bindParam(size_t i, long value)               { params_[i].integer = value; }
+    void bindParam(size_t i, unsigned long value)      { params_[i].integer = static_cast<long long>(value); }
+    void bindParam(size_t i, bool value)               { params_[i].integer = value ? 1 : 0; }
+    void bindParam(size_t i, const std::string &value) { bindText(i, value.data(), value.size()); }
+    void bindParam(size_t i, std::string_view value)   { bindText(i, value.data(), value.size()); }
+    void bindText(size_t i, const char *data, size_t size);
+
+    bool run();
+    bool retryable(unsigned int err) const;
+    bool executeOnce();
+    bool bindResults();
+    void freeResult();
+
+    MYSQL       *conn_;
+    std::string  sql_;
+    MYSQL_STMT  *stmt_;
+    bool         idempotent_;   // 断线后结果未知时能否重试
+    bool         hasResult_;
+    std::string  error_;   // 本地错误（参数个数不符等）
+
+    std::vector<Param>     params_;
+    std::vector<MYSQL_BIND> paramBinds_;
+    std::vector<Column>    columns_;
+    std::vector<MYSQL_BIND> resultBinds_;
+};
+
+/**
+ * SqlConn — 连接池中的一条连接及其预处理语句缓存
+ *
+ * 连接建立时 prepareAll 一次；借出时若发现已自动重连（thread id 变化）则整体重新
+ * prepare。文本 SQL 仍可通过 mysql() 直接执行。
+ */
+class SqlConn
+{
+public:
+    explicit SqlConn(MYSQL *mysql);
+    ~SqlConn();   // 先关闭语句句柄，再关闭连接
+
+    SqlConn(const SqlConn &) = delete;
+    SqlConn &operator=(const SqlConn &) = delete;
+
+    MYSQL *mysql() const { return mysql_; }
+    SqlStatement &stmt(StmtId id) { return *stmts_[static_cast<size_t>(id)]; }
+
+    void prepareAll();
+    void checkReconnect();   // mysql_ping 之后调用
+
+private:
+    MYSQL *mysql_;
+    unsigned long threadId_;
+    std::array<std::unique_ptr<SqlStatement>, kStmtCount> stmts_;
+};
+
+#endif
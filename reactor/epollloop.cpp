@@ -0,0 +1,220 @@
+#include "epollloop.h"
+#include "chat/chat.h"
+#include "threadpool/threadpool.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// 辅助函数：将 fd 设置为非阻塞
+static int setNonBlocking(int fd)
+{
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags == -1) return -1;
+    return ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// 构造 / 析构
+EpollLoop::EpollLoop(int id, Threadpool* pool)
+    : EventLoop(id), epollFd_(-1), listenFd_(-1), pool_(pool)
+{
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0)
+        throw std::runtime_error("epoll_create1() failed: " + std::string(strerror(errno)));
+
+    epollAdd(wakeupFd_, EPOLLIN);
+}
+
+EpollLoop::~EpollLoop()
+{
+    if (epollFd_ >= 0) ::close(epollFd_);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 事件循环
+// ────────────────────────────────────────────────────────────────────────────
+void EpollLoop::loop()
+{
+    threadId_ = std::this_thread::get_id();
+    running_  = true;
+
+    epoll_event events[MAX_EVENTS];
+
+    while (running_)
+    {
+        // 超时唤醒用于推进时间轮
+        int n = ::epoll_wait(epollFd_, events, MAX_EVENTS, TIMER_INTERVAL * 1000);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue; // 被信号中断，属正常情况
+            break;
+        }
+
+        time_t now = CoarseClock::update();
+
+        for (int i = 0; i < n; ++i)
+        {
+            int      fd = events[i].data.fd;
+            uint32_t ev = events[i].events;
+
+            if (fd == wakeupFd_)
+            {
+                handleWakeup();
+            }
+            else if (fd == listenFd_)
+            {
+                // ── 新连接到来 ──
+                handleAccept();
+            }
+            else if (ev & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                // ── 连接异常或对端关闭 ──
+                if (auto session = findSession(fd))
+                    closeSession(session);
+            }
+            else
+            {
+                handleEvent(fd, ev);
+            }
+        }
+
+        afterEvents(now);
+    }
+}
+
+void EpollLoop::setListenFd(int listenFd)
+{
+    listenFd_ = listenFd;
+    // 监听 fd 只需要 EPOLLIN，无需 EPOLLONESHOT
+    epollAdd(listenFd_, EPOLLIN | EPOLLET);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// Epoll 封装
+// ────────────────────────────────────────────────────────────────────────────
+int EpollLoop::epollAdd(int fd, uint32_t events)
+{
+    epoll_event ev{};
+    ev.data.fd = fd;
+    ev.events  = events;
+    return ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int EpollLoop::epollMod(int fd, uint32_t events)
+{
+    epoll_event ev{};
+    ev.data.fd = fd;
+    ev.events  = events;
+    return ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+int EpollLoop::epollDel(int fd)
+{
+    return ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+uint32_t EpollLoop::baseEvents() const
+{
+    // Worker 模式：EPOLLONESHOT，同一 fd 的事件每次只触发一次，处理完由 Session 的 strand 重新 arm
+    // 内联模式：水平触发，单线程处理无需 ONESHOT
+    // EPOLLRDHUP：内核探测到对端关闭，提前通知
+    if (pool_)
+        return EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLRDHUP;
+    return EPOLLIN | EPOLLRDHUP;
+}
+
+int EpollLoop::updateEvents(ChatSession* session, bool wantRead, bool wantWrite)
+{
+    // 背压暂停读取时去掉 EPOLLIN，EPOLLRDHUP / EPOLLHUP 仍会上报
+    uint32_t events = baseEvents();
+    if (!wantRead)  events &= ~static_cast<uint32_t>(EPOLLIN);
+    if (wantWrite)  events |= EPOLLOUT;
+    return epollMod(session->getSocketFd(), events);
+}
+
+bool EpollLoop::attachSession(const std::shared_ptr<ChatSession>& session)
+{
+    return epollAdd(session->getSocketFd(), baseEvents()) == 0;
+}
+
+void EpollLoop::detachSession(const std::shared_ptr<ChatSession>& session)
+{
+    int fd = session->getSocketFd();
+    if (fd >= 0)
+        epollDel(fd);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 连接接入
+// ────────────────────────────────────────────────────────────────────────────
+void EpollLoop::handleAccept()
+{
+    // 在 ET 模式下需要循环 accept 直到 EAGAIN
+    while (true)
+    {
+        sockaddr_in clientAddr{};
+        socklen_t   addrLen = sizeof(clientAddr);
+
+        int connFd = ::accept(listenFd_,
+                              reinterpret_cast<sockaddr*>(&clientAddr),
+                              &addrLen);
+        if (connFd < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break; // 已无待处理连接
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        setNonBlocking(connFd);
+        onAccepted(connFd);
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 读写事件分派
+// ────────────────────────────────────────────────────────────────────────────
+void EpollLoop::handleEvent(int fd, uint32_t ev)
+{
+    auto session = findSession(fd);
+    if (!session)
+        return;
+
+    uint32_t events = 0;
+    if (ev & EPOLLIN)  events |= ChatSession::kEvRead;
+    if (ev & EPOLLOUT) events |= ChatSession::kEvWrite;
+
+    if (!pool_)
+    {
+        // ── Sub-Reactor：在本 loop 线程内联完成读、解包、业务与写 ──
+        session->handleEvents(events);
+        if (session->closed())
+            handleClose(session);
+        return;
+    }
+
+    // ── 单 Reactor：事件记入 Session，由其 strand 在线程池中处理 ──
+    // strand 已在执行时只合并事件，不再投递
+    session->post(events);
+}
+
+void EpollLoop::schedule(const std::shared_ptr<ChatSession>& session)
+{
+    if (!pool_)
+    {
+        EventLoop::schedule(session);
+        return;
+    }
+
+    pool_->post([this, session] {
+        session->runStrand();
+
+        // strand 内关闭（对端断开、解包失败、慢消费者）后在此清理
+        if (session->closed())
+            handleClose(session);
+    });
+}
@@ -0,0 +1,48 @@
+#ifndef EPOLL_LOOP_H
+#define EPOLL_LOOP_H
+
+#include <sys/epoll.h>
+#include "eventloop.h"
+
+class Threadpool;
+
+/**
+ * EpollLoop — epoll 驱动的 EventLoop
+ *
+ *   - Worker 模式（pool 非空）：即原来的 单 Reactor + 线程池，读写事件记入 Session，
+ *     由 Session 的 strand 在线程池中串行处理；EPOLLONESHOT 只用于避免重复事件刷屏。
+ *   - 内联模式（pool 为空）：作为 Sub-Reactor，连接的读、解包、业务与写都在本 loop 线程完成，
+ *     没有跨线程投递，也不需要 EPOLLONESHOT。
+ */
+class EpollLoop : public EventLoop {
+public:
+    explicit EpollLoop(int id, Threadpool* pool = nullptr);
+    ~EpollLoop() override;
+
+    void loop() override;
+    void setListenFd(int listenFd) override;
+    int  updateEvents(ChatSession* session, bool wantRead, bool wantWrite) override;
+    void schedule(const std::shared_ptr<ChatSession>& session) override;
+    bool inlineSessions() const override { return pool_ == nullptr; }
+    bool rearmAfterEvent() const override { return pool_ != nullptr; }
+
+protected:
+    bool attachSession(const std::shared_ptr<ChatSession>& session) override;
+    void detachSession(const std::shared_ptr<ChatSession>& session) override;
+
+private:
+    int  epollAdd(int fd, uint32_t events);
+    int  epollMod(int fd, uint32_t events);
+    int  epollDel(int fd);
+    uint32_t baseEvents() const;
+
+    void handleAccept();
+    void handleEvent(int fd, uint32_t ev); // 内联模式 / Worker 模式分派
+
+private:
+    int  epollFd_;
+    int  listenFd_;
+    Threadpool* pool_;                     // 非空即 Worker 模式
+};
+
+#endif
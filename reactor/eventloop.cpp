@@ -0,0 +1,203 @@
+#include "eventloop.h"
+#include "chat/chat.h"
+#include "chat/epoch.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// 构造 / 析构
+EventLoop::EventLoop(int id)
+    : id_(id), wakeupFd_(-1), running_(false), threadId_(std::thread::id()),
+      heartbeatWheel_(CoarseClock::now())
+{
+    wakeupFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd_ < 0)
+        throw std::runtime_error("eventfd() failed: " + std::string(strerror(errno)));
+}
+
+EventLoop::~EventLoop()
+{
+    std::unordered_map<int, std::shared_ptr<ChatSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        sessions.swap(sessions_);
+    }
+    for (auto& [fd, session] : sessions)
+    {
+        session->close();
+        session->releaseFd();
+    }
+
+    if (wakeupFd_ >= 0) ::close(wakeupFd_);
+}
+
+void EventLoop::quit()
+{
+    running_ = false;
+    wakeup();
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 跨线程任务投递
+// ────────────────────────────────────────────────────────────────────────────
+void EventLoop::queueInLoop(Functor cb)
+{
+    {
+        std::lock_guard<std::mutex> lock(functorsMutex_);
+        pendingFunctors_.push_back(std::move(cb));
+    }
+    wakeup();
+}
+
+void EventLoop::wakeup()
+{
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+void EventLoop::handleWakeup()
+{
+    uint64_t one = 0;
+    ssize_t n = ::read(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+void EventLoop::doPendingFunctors()
+{
+    std::vector<Functor> functors;
+    {
+        std::lock_guard<std::mutex> lock(functorsMutex_);
+        functors.swap(pendingFunctors_);
+    }
+    for (auto& cb : functors)
+        cb();
+}
+
+void EventLoop::afterEvents(time_t now)
+{
+    doPendingFunctors();
+
+    if (now > heartbeatWheel_.current())
+        handleTimeout(now);
+}
+
+size_t EventLoop::sessionCount() const
+{
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    return sessions_.size();
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 连接生命周期管理
+// ────────────────────────────────────────────────────────────────────────────
+void EventLoop::onAccepted(int connFd)
+{
+    if (acceptObserver_)
+        acceptObserver_();
+
+    if (connectionCallback_)
+        connectionCallback_(connFd);
+    else
+        newSession(connFd);
+}
+
+void EventLoop::addConnection(int connFd)
+{
+    if (isInLoopThread())
+        newSession(connFd);
+    else
+        queueInLoop([this, connFd] { newSession(connFd); });
+}
+
+void EventLoop::newSession(int connFd)
+{
+    auto session = std::make_shared<ChatSession>(connFd, this);
+
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        sessions_[connFd] = session;
+    }
+
+    if (!attachSession(session))
+    {
+        handleClose(session);
+        return;
+    }
+
+    heartbeatWheel_.add(CoarseClock::now() + HEARTBEAT_TIMEOUT + 1, session);
+}
+
+std::shared_ptr<ChatSession> EventLoop::findSession(int fd) const
+{
+    std::lock_guard<std::mutex> lock(sessionsMutex_);
+    auto it = sessions_.find(fd);
+    if (it == sessions_.end()) return nullptr;
+    return it->second; // 增加引用计数，处理期间 session 不会析构
+}
+
+void EventLoop::schedule(const std::shared_ptr<ChatSession>& session)
+{
+    queueInLoop([this, session] {
+        session->runStrand();
+        if (session->closed())
+            handleClose(session);
+    });
+}
+
+void EventLoop::handleClose(const std::shared_ptr<ChatSession>& session)
+{
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex_);
+        auto it = sessions_.find(session->getSocketFd());
+        if (it == sessions_.end() || it->second != session) return; // 已经被处理过，幂等保护
+        sessions_.erase(it);
+    }
+
+    // 关闭 Session（停止收发、通知 UserManager 下线；内部有 isClosed 幂等保护）
+    session->close();
+
+    // 从 I/O 驱动上摘除后才释放 fd，此后 fd 号才可能被新连接复用
+    detachSession(session);
+    session->releaseFd();
+}
+
+void EventLoop::closeSession(const std::shared_ptr<ChatSession>& session)
+{
+    // Worker 模式下 Session 可能正在某个 Worker 上处理，交给它的 strand 关闭，结束后回到 handleClose
+    if (inlineSessions())
+        handleClose(session);
+    else
+        session->post(ChatSession::kEvClose);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 定时器任务 —— 时间轮驱动的心跳超时检测
+// ────────────────────────────────────────────────────────────────────────────
+void EventLoop::handleTimeout(time_t now)
+{
+    // 惰性顺延：processRead / handleHeartbeat 只刷新 lastActiveTime，
+    // 条目到期时再按最新活跃时间决定关闭或重挂，每个连接每个超时周期至多重挂一次
+    std::vector<std::shared_ptr<ChatSession>> toClose;
+    heartbeatWheel_.advance(now, [&](std::weak_ptr<ChatSession>&& weak) {
+        auto session = weak.lock();
+        if (!session || session->closed())
+            return;
+
+        time_t deadline = session->getLastActiveTime() + HEARTBEAT_TIMEOUT + 1;
+        if (deadline > now)
+            heartbeatWheel_.add(deadline, std::move(weak));
+        else
+            toClose.push_back(std::move(session));
+    });
+
+    for (auto& session : toClose)
+        closeSession(session);
+
+    // 用户表写入稀少时，退役的旧快照也按 tick 回收
+    EpochDomain::instance().reclaim();
+}
@@ -0,0 +1,115 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <ctime>
+#include "timingwheel.h"
+
+class ChatSession;
+
+static constexpr int MAX_EVENTS        = 1024;
+static constexpr int HEARTBEAT_TIMEOUT = 30;   // 心跳超时阈值（秒）
+static constexpr int TIMER_INTERVAL    = 1;    // 时间轮 tick（秒）
+
+/**
+ * EventLoop — 一个 Reactor（one loop per thread）的公共部分
+ *
+ * 每个 EventLoop 拥有独立的 fd → ChatSession 映射表、心跳时间轮和跨线程任务队列；
+ * I/O 驱动由子类实现：
+ *   - EpollLoop：epoll 驱动，支持 Worker 模式（单 Reactor + 线程池）与内联模式（Sub-Reactor）。
+ *   - UringLoop：io_uring 驱动（multishot accept / provided-buffer recv / 异步 send），仅内联模式。
+ *
+ * 连接来源：本 loop 自己 accept（setListenFd，用于 SO_REUSEPORT 或单 Reactor），
+ *           或由 Main Reactor 通过 addConnection() 跨线程移交。
+ */
+class EventLoop {
+public:
+    using Functor            = std::function<void()>;
+    using ConnectionCallback = std::function<void(int connFd)>;
+
+    explicit EventLoop(int id);
+    virtual ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // 事件循环（阻塞），必须在所属线程调用
+    virtual void loop() = 0;
+    // 线程安全：通知 loop 退出
+    void quit();
+
+    // 由本 loop 负责 accept 的监听 fd（需在 loop() 之前设置）
+    virtual void setListenFd(int listenFd) = 0;
+    // 设置后 accept 到的连接交给回调处理（Main Reactor 轮询分发），否则在本 loop 建立 Session
+    void setConnectionCallback(ConnectionCallback cb) { connectionCallback_ = std::move(cb); }
+    // 每次 accept 到连接时调用（在分发之前），需在 loop() 之前设置
+    void setAcceptObserver(Functor cb) { acceptObserver_ = std::move(cb); }
+
+    // 线程安全：接管一个已 accept 的连接
+    void addConnection(int connFd);
+
+    // 线程安全：投递任务到 loop 线程执行
+    void queueInLoop(Functor cb);
+    bool isInLoopThread() const { return threadId_.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
+
+    // 由 Session 所属线程调用：是否继续读取（背压暂停），输出缓冲区是否有待发送数据
+    virtual int updateEvents(ChatSession* session, bool wantRead, bool wantWrite) = 0;
+    // 是否允许 Session 在发送队列为空时直接同步写出（写直通）
+    virtual bool writeThrough() const { return true; }
+
+    // 线程安全：安排 Session 的 strand（ChatSession::runStrand）执行，默认排进本 loop 线程
+    virtual void schedule(const std::shared_ptr<ChatSession>& session);
+    // Session 是否在 loop 线程内联处理（否则其 strand 在线程池中执行）
+    virtual bool inlineSessions() const { return true; }
+    // 事件触发后驱动是否已撤销关注（EPOLLONESHOT），需由 Session 重新 arm
+    virtual bool rearmAfterEvent() const { return false; }
+
+    size_t sessionCount() const;
+    int    id() const { return id_; }
+
+protected:
+    // 子类钩子：把新 Session 挂到 I/O 驱动上 / 从驱动上摘除（均在 loop 线程或 Worker 中调用）
+    virtual bool attachSession(const std::shared_ptr<ChatSession>& session) = 0;
+    virtual void detachSession(const std::shared_ptr<ChatSession>& session) = 0;
+
+    void onAccepted(int connFd);           // 交给连接回调，或在本 loop 建立 Session
+    void newSession(int connFd);           // 必须在 loop 线程中调用
+    void handleClose(const std::shared_ptr<ChatSession>& session);  // 摘除并释放：Session 所属线程之外不能有人正在处理它
+    void closeSession(const std::shared_ptr<ChatSession>& session); // loop 线程发起的关闭（心跳超时、HUP）
+    std::shared_ptr<ChatSession> findSession(int fd) const;
+
+    void handleTimeout(time_t now);        // 推进时间轮，关闭心跳超时的连接
+    void afterEvents(time_t now);          // 每轮事件处理后：执行跨线程任务、推进时间轮
+
+    void wakeup();
+    void handleWakeup();
+    void doPendingFunctors();
+
+protected:
+    int  id_;
+    int  wakeupFd_;                        // eventfd，用于跨线程唤醒
+    std::atomic<bool> running_;
+    std::atomic<std::thread::id> threadId_; // loop() 启动前为空，其他线程的 addConnection 一律排队
+
+    ConnectionCallback connectionCallback_;
+    Functor            acceptObserver_;
+
+    // fd → ChatSession 映射表（Worker 模式下 Worker 线程也会访问，需 sessionsMutex_ 保护）
+    // Session 的 fd 在 handleClose 摘除后才释放，表中的 fd 不会被新连接复用
+    std::unordered_map<int, std::shared_ptr<ChatSession>> sessions_;
+    mutable std::mutex sessionsMutex_;
+
+    // 心跳时间轮（仅 loop 线程访问）：每个 Session 一个条目，到期时若期间有活动则顺延重挂
+    TimingWheel<std::weak_ptr<ChatSession>> heartbeatWheel_;
+
+    std::vector<Functor> pendingFunctors_;
+    std::mutex           functorsMutex_;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+/**
+ * MpscQueue — 多生产者单消费者无锁队列（Vyukov 链表队列）
+ *
+ * push 可在任意线程并发调用，只有一次原子 exchange；
+ * pop 同一时刻只能有一个消费者（Session 的 strand 保证这一点）。
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value)) {}
+        if (tail_ != &stub_)
+            delete tail_;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *prev = head_.exchange(node);
+        prev->next.store(node);
+    }
+
+    // 仅消费者调用；生产者 push 到一半（尚未链接）时也视为空，由调度方重新检查
+    bool pop(T &value)
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load();
+        if (!next)
+            return false;
+
+        value = std::move(next->value);
+        tail_ = next;
+        if (tail != &stub_)
+            delete tail;
+        return true;
+    }
+
+    bool empty() const { return tail_->next.load() == nullptr; }
+
+private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+
+        T value;
+        std::atomic<Node *> next{nullptr};
+    };
+
+    Node stub_;
+    std::atomic<Node *> head_;   // 生产者端
+    Node *tail_;                 // 消费者端（已取走的最后一个节点）
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+/**
+ * CoarseClock — 粗粒度单调时钟（秒）
+ *
+ * 每个 EventLoop 每轮 epoll_wait 返回后 update() 一次（CLOCK_MONOTONIC_COARSE 走 vDSO），
+ * 热路径（processRead / handleHeartbeat）只做一次 relaxed load，不再每次 time(nullptr)。
+ */
+class CoarseClock {
+public:
+    static time_t now() { return now_.load(std::memory_order_relaxed); }
+
+    static time_t update()
+    {
+        time_t t = read();
+        now_.store(t, std::memory_order_relaxed);
+        return t;
+    }
+
+private:
+    static time_t read()
+    {
+        timespec ts{};
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return ts.tv_sec;
+    }
+
+    inline static std::atomic<time_t> now_{read()};
+};
+
+/**
+ * TimingWheel — 两级分层时间轮（tick = 1 秒）
+ *
+ *   level 0：256 个槽，覆盖未来 256 tick；
+ *   level 1：64 个槽，每槽 256 tick，覆盖约 4.5 小时，超出的截断到最远槽。
+ * level 0 每转一圈，把 level 1 对应槽里的条目下放（cascade）到 level 0。
+ *
+ * 插入 O(1)，advance 只触碰到期槽，代价 O(到期条目)。
+ * 非线程安全：只能在所属 EventLoop 线程中使用。
+ */
+template <class T>
+class TimingWheel {
+public:
+    explicit TimingWheel(int64_t nowTick) : current_(nowTick), size_(0) {}
+
+    // 在 expireTick 到期（不早于下一个 tick）
+    void add(int64_t expireTick, T item)
+    {
+        if (expireTick <= current_)
+            expireTick = current_ + 1;
+
+        int64_t delta = expireTick - current_;
+        if (delta < kL0Size)
+        {
+            l0_[expireTick & kL0Mask].push_back({expireTick, std::move(item)});
+        }
+        else
+        {
+            if (delta >= kMaxSpan)
+                expireTick = current_ + kMaxSpan - 1;
+            l1_[(expireTick >> kL0Bits) & kL1Mask].push_back({expireTick, std::move(item)});
+        }
+        ++size_;
+    }
+
+    // 推进到 nowTick，到期条目依次交给 onExpire(T&&)；回调内可以再次 add()
+    template <class F>
+    void advance(int64_t nowTick, F&& onExpire)
+    {
+        while (current_ < nowTick)
+        {
+            ++current_;
+            if ((current_ & kL0Mask) == 0)
+                cascade();
+
+            auto& slot = l0_[current_ & kL0Mask];
+            if (slot.empty())
+                continue;
+
+            std::vector<Node> due;
+            due.swap(slot);
+            size_ -= due.size();
+            for (auto& node : due)
+                onExpire(std::move(node.item));
+        }
+    }
+
+    size_t  size()    const { return size_; }
+    int64_t current() const { return current_; }
+
+private:
+    static constexpr int     kL0Bits  = 8;
+    static constexpr int     kL1Bits  = 6;
+    static constexpr int64_t kL0Size  = int64_t(1) << kL0Bits;
+    static constexpr int64_t kL1Size  = int64_t(1) << kL1Bits;
+    static constexpr int64_t kL0Mask  = kL0Size - 1;
+    static constexpr int64_t kL1Mask  = kL1Size - 1;
+    static constexpr int64_t kMaxSpan = kL0Size * (kL1Size - 1);
+
+    struct Node {
+        int64_t expireTick;
+        T       item;
+    };
+
+    // 当前 tick 恰好跨过 level 0 一圈：level 1 对应槽的条目都在接下来 256 tick 内到期
+    void cascade()
+    {
+        auto& slot = l1_[(current_ >> kL0Bits) & kL1Mask];
+        if (slot.empty())
+            return;
+
+        std::vector<Node> nodes;
+        nodes.swap(slot);
+        for (auto& node : nodes)
+            l0_[node.expireTick & kL0Mask].push_back(std::move(node));
+    }
+
+    int64_t current_;
+    size_t  size_;
+    std::vector<Node> l0_[kL0Size];
+    std::vector<Node> l1_[kL1Size];
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include "uring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static int sysSetup(unsigned entries, io_uring_params* p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static std::runtime_error uringError(const char* what, int err)
+{
+    return std::runtime_error(std::string(what) + " failed: " + strerror(err));
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 构造 / 析构
+// ────────────────────────────────────────────────────────────────────────────
+IoUring::IoUring(unsigned entries)
+    : ringFd_(-1), sqRing_(nullptr), sqRingSize_(0), sqes_(nullptr), sqesSize_(0), sqeTail_(0),
+      cqRing_(nullptr), cqRingSize_(0),
+      bufBase_(nullptr), bufPoolSize_(0), bufSize_(0), bgid_(0)
+{
+    io_uring_params p{};
+    // 完成事件只在 loop 线程进入内核时处理，不需要 IPI 打断；旧内核不支持时退回普通模式
+    // （ring 在主线程创建、在 loop 线程提交，不能用 SINGLE_ISSUER）
+    p.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+    ringFd_ = sysSetup(entries, &p);
+    if (ringFd_ < 0 && errno == EINVAL)
+    {
+        p = io_uring_params{};
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 4;
+        ringFd_ = sysSetup(entries, &p);
+    }
+    if (ringFd_ < 0)
+        throw uringError("io_uring_setup()", errno);
+
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        int err = errno;
+        sqRing_ = nullptr;
+        ::close(ringFd_);
+        throw uringError("mmap(SQ ring)", err);
+    }
+
+    if (singleMmap)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            int err = errno;
+            cqRing_ = nullptr;
+            ::munmap(sqRing_, sqRingSize_);
+            ::close(ringFd_);
+            throw uringError("mmap(CQ ring)", err);
+        }
+    }
+
+    sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        int err = errno;
+        if (cqRing_ != sqRing_) ::munmap(cqRing_, cqRingSize_);
+        ::munmap(sqRing_, sqRingSize_);
+        ::close(ringFd_);
+        throw uringError("mmap(SQEs)", err);
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_    = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_    = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask_    = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+    sqeTail_   = *sqTail_;
+
+    // SQ array 固定为恒等映射，之后只需推进 tail
+    unsigned* array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; ++i)
+        array[i] = i;
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_   = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+}
+
+IoUring::~IoUring()
+{
+    if (ringFd_ >= 0) ::close(ringFd_);
+    if (bufBase_) ::munmap(bufBase_, bufPoolSize_);
+    if (sqes_) ::munmap(sqes_, sqesSize_);
+    if (cqRing_ && cqRing_ != sqRing_) ::munmap(cqRing_, cqRingSize_);
+    if (sqRing_) ::munmap(sqRing_, sqRingSize_);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 提交
+// ────────────────────────────────────────────────────────────────────────────
+io_uring_sqe* IoUring::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqeTail_ - head >= sqEntries_)
+    {
+        submit();
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqeTail_ - head >= sqEntries_)
+            return nullptr;
+    }
+
+    io_uring_sqe* sqe = &sqes_[sqeTail_ & sqMask_];
+    ++sqeTail_;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submit(unsigned waitNr)
+{
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    unsigned toSubmit = sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    unsigned flags    = waitNr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    if (toSubmit == 0 && waitNr == 0)
+        return 0;
+
+    int ret = sysEnter(ringFd_, toSubmit, waitNr, flags);
+    return ret < 0 ? -errno : ret;
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// provided buffers
+// ────────────────────────────────────────────────────────────────────────────
+void IoUring::setupBuffers(uint16_t bgid, unsigned count, unsigned bufSize)
+{
+    bufPoolSize_ = static_cast<size_t>(count) * bufSize;
+    void* base = ::mmap(nullptr, bufPoolSize_, PROT_READ | PROT_WRITE,
+                        MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (base == MAP_FAILED)
+        throw uringError("mmap(buffers)", errno);
+    bufBase_ = static_cast<char*>(base);
+    bufSize_ = bufSize;
+    bgid_    = bgid;
+
+    for (unsigned i = 0; i < count; ++i)
+        recycleBuffer(static_cast<uint16_t>(i));
+    publishBuffers();
+}
+
+void IoUring::publishBuffers()
+{
+    if (recycled_.empty())
+        return;
+
+    std::sort(recycled_.begin(), recycled_.end());
+
+    size_t i = 0;
+    while (i < recycled_.size())
+    {
+        size_t j = i + 1;
+        while (j < recycled_.size() && recycled_[j] == recycled_[j - 1] + 1)
+            ++j;
+
+        io_uring_sqe* sqe = getSqe();
+        if (!sqe)
+            break;
+        sqe->opcode    = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd        = static_cast<int>(j - i);               // 缓冲区个数
+        sqe->addr      = reinterpret_cast<uint64_t>(buffer(recycled_[i]));
+        sqe->len       = bufSize_;
+        sqe->off       = recycled_[i];                          // 起始 bid
+        sqe->buf_group = bgid_;
+        sqe->user_data = kBufferUserData;
+        i = j;
+    }
+    recycled_.erase(recycled_.begin(), recycled_.begin() + i);
+}
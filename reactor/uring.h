@@ -0,0 +1,89 @@
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * IoUring — 最小化的 io_uring 封装（直接走系统调用，不依赖 liburing）
+ *
+ * 只提供 UringLoop 需要的部分：SQ/CQ 映射、提交与收割、provided buffers。
+ * 非线程安全：只能在所属 loop 线程使用。初始化失败（内核不支持、被禁用）抛 std::runtime_error。
+ */
+class IoUring {
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // 取一个空闲 SQE（已清零）；SQ 满时先提交再取，仍失败返回 nullptr
+    io_uring_sqe* getSqe();
+
+    // 提交已填好的 SQE，waitNr > 0 时至少等待 waitNr 个完成事件
+    int submit(unsigned waitNr = 0);
+
+    // 提供给 provided buffer 的 SQE 使用的 user_data（调用方据此忽略其完成事件）
+    static constexpr uint64_t kBufferUserData = 0;
+
+    // 逐个处理已完成的 CQE，返回处理数量
+    template <class F>
+    unsigned forEachCqe(F&& fn)
+    {
+        unsigned head  = *cqHead_;
+        unsigned tail  = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head, ++count)
+        {
+            // 先拷贝再推进 head，回调中可以继续 getSqe()/submit()
+            io_uring_cqe cqe = cqes_[head & cqMask_];
+            __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+            fn(cqe);
+        }
+        return count;
+    }
+
+    // ── provided buffers：内核在 recv 完成时自行挑选缓冲区 ──
+    // 用 IORING_OP_PROVIDE_BUFFERS 登记（PBUF_RING 在部分内核 / 沙箱上不可用，这里取兼容面更广的做法）
+    void setupBuffers(uint16_t bgid, unsigned count, unsigned bufSize);
+    char*    buffer(uint16_t bid) const { return bufBase_ + static_cast<size_t>(bid) * bufSize_; }
+    unsigned bufferSize() const { return bufSize_; }
+    uint16_t bufferGroup() const { return bgid_; }
+    // 把缓冲区还给内核（批量累积，publishBuffers() 时合并连续编号，一段一个 SQE）
+    void recycleBuffer(uint16_t bid) { recycled_.push_back(bid); }
+    void publishBuffers();
+
+private:
+    int ringFd_;
+
+    // SQ
+    void*     sqRing_;
+    size_t    sqRingSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned  sqMask_;
+    unsigned  sqEntries_;
+    io_uring_sqe* sqes_;
+    size_t    sqesSize_;
+    unsigned  sqeTail_;   // 本地尚未发布的 tail
+
+    // CQ
+    void*     cqRing_;
+    size_t    cqRingSize_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned  cqMask_;
+    io_uring_cqe* cqes_;
+
+    // provided buffers
+    char*     bufBase_;
+    size_t    bufPoolSize_;
+    unsigned  bufSize_;
+    uint16_t  bgid_;
+    std::vector<uint16_t> recycled_;
+};
+
+#endif
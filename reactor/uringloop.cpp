@@ -0,0 +1,413 @@
+#include "uringloop.h"
+#include "chat/chat.h"
+
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+// 构造 / 析构
+UringLoop::UringLoop(int id)
+    : EventLoop(id), ring_(kRingEntries), listenFd_(-1), tick_{TIMER_INTERVAL, 0}, nextConnId_(1)
+{
+    ring_.setupBuffers(0, kBufCount, kBufSize);
+    armWakeup();
+    armTick();
+}
+
+UringLoop::~UringLoop() = default;
+
+// ────────────────────────────────────────────────────────────────────────────
+// 事件循环
+// ────────────────────────────────────────────────────────────────────────────
+void UringLoop::loop()
+{
+    threadId_ = std::this_thread::get_id();
+    running_  = true;
+
+    while (running_)
+    {
+        flushPending();
+
+        // 提交本轮所有 SQE 并等待至少一个完成事件（tick 保证最迟 1 秒返回）
+        int ret = ring_.submit(1);
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY && ret != -ETIME)
+        {
+            std::cerr << "[UringLoop] io_uring_enter failed: " << ret << std::endl;
+            break;
+        }
+
+        time_t now = CoarseClock::update();
+
+        ring_.forEachCqe([this](const io_uring_cqe& cqe) { handleCqe(cqe); });
+        ring_.publishBuffers();
+
+        afterEvents(now);
+    }
+}
+
+void UringLoop::setListenFd(int listenFd)
+{
+    listenFd_ = listenFd;
+    armAccept();
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// SQE 准备
+// ────────────────────────────────────────────────────────────────────────────
+void UringLoop::armAccept()
+{
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) return;
+    sqe->opcode       = IORING_OP_ACCEPT;
+    sqe->fd           = listenFd_;
+    sqe->ioprio       = multishotAccept_ ? IORING_ACCEPT_MULTISHOT : 0;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data    = encode(0, kAccept);
+}
+
+void UringLoop::armWakeup()
+{
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) return;
+    sqe->opcode       = IORING_OP_POLL_ADD;
+    sqe->fd           = wakeupFd_;
+    sqe->poll32_events = POLLIN;
+    sqe->len          = IORING_POLL_ADD_MULTI;
+    sqe->user_data    = encode(0, kWakeup);
+}
+
+void UringLoop::armTick()
+{
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) return;
+    sqe->opcode    = IORING_OP_TIMEOUT;
+    sqe->fd        = -1;
+    sqe->addr      = reinterpret_cast<uint64_t>(&tick_);
+    sqe->len       = 1;
+    sqe->user_data = encode(0, kTick);
+}
+
+void UringLoop::armRecv(uint64_t connId, Conn& conn)
+{
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) return;
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = conn.fd;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = ring_.bufferGroup();
+    sqe->user_data = encode(connId, kRecv);
+    conn.recvArmed      = true;
+    conn.recvCancelling = false;
+}
+
+void UringLoop::startSend(uint64_t connId, Conn& conn)
+{
+    if (conn.sendBusy || conn.detached)
+        return;
+
+    // 上一段已发完：把 Session 期间攒下的所有帧整体换出，聚合成一次 sendmsg
+    if (conn.sending.empty())
+    {
+        if (!conn.session->takeOutput(conn.sending))
+            return;
+    }
+
+    // SQ 提交后仍满：已取出的帧留在 conn.sending，下一轮 flushPending 再试，不能等别的事件来触发
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe)
+    {
+        pendingFlush_.push_back(conn.session.get());
+        return;
+    }
+    conn.msg = msghdr{};
+    conn.msg.msg_iov    = conn.iov;
+    conn.msg.msg_iovlen = conn.sending.fillIov(conn.iov, OutputQueue::kMaxIov);
+
+    sqe->opcode    = IORING_OP_SENDMSG;
+    sqe->fd        = conn.fd;
+    sqe->addr      = reinterpret_cast<uint64_t>(&conn.msg);
+    sqe->len       = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = encode(connId, kSend);
+    conn.sendBusy  = true;
+}
+
+void UringLoop::cancel(uint64_t userData)
+{
+    io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) return;
+    sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+    sqe->fd        = -1;
+    sqe->addr      = userData;
+    sqe->user_data = encode(0, kCancel);
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// Session 挂载 / 摘除
+// ────────────────────────────────────────────────────────────────────────────
+bool UringLoop::attachSession(const std::shared_ptr<ChatSession>& session)
+{
+    uint64_t connId = nextConnId_++;
+    Conn& conn   = conns_[connId];
+    conn.session = session;
+    conn.fd      = session->getSocketFd();
+    connIds_[session.get()] = connId;
+
+    armRecv(connId, conn);
+    return true;
+}
+
+void UringLoop::detachSession(const std::shared_ptr<ChatSession>& session)
+{
+    auto it = connIds_.find(session.get());
+    if (it == connIds_.end())
+        return;
+
+    uint64_t connId = it->second;
+    Conn& conn = conns_[connId];
+    conn.detached = true;
+    connIds_.erase(it);
+
+    // fd 随后由 handleClose 释放；ring 对文件的引用要等在途请求取消后才释放
+    if (conn.recvArmed) cancel(encode(connId, kRecv));
+    if (conn.sendBusy)  cancel(encode(connId, kSend));
+    releaseIfIdle(connId);
+}
+
+void UringLoop::closeConn(Conn& conn)
+{
+    if (conn.detached)
+        return;
+    auto session = conn.session; // handleClose 可能释放 conn
+    handleClose(session);
+}
+
+void UringLoop::releaseIfIdle(uint64_t connId)
+{
+    auto it = conns_.find(connId);
+    if (it == conns_.end())
+        return;
+    const Conn& conn = it->second;
+    if (conn.detached && !conn.recvArmed && !conn.sendBusy)
+        conns_.erase(it);
+}
+
+// 由 Session 在 loop 线程（所属线程）调用，只登记请求，不能在此回调 Session。
+// 读写关注不在这里使用：flushPending 时由 takeOutput / readPaused 从 Session 取当时的状态
+int UringLoop::updateEvents(ChatSession* session, bool /*wantRead*/, bool /*wantWrite*/)
+{
+    // 有数据要发，或读关注变化（背压、等待数据库结果）需要取消 / 重挂 recv
+    pendingFlush_.push_back(session);
+    return 0;
+}
+
+void UringLoop::flushPending()
+{
+    std::vector<ChatSession*> sessions;
+    sessions.swap(pendingFlush_);
+    for (ChatSession* s : sessions)
+    {
+        // 只认仍挂在本 loop 上的 Session（connIds_ 中的条目由 conns_ 持有所有权）
+        auto it = connIds_.find(s);
+        if (it == connIds_.end())
+            continue;
+        Conn& conn = conns_[it->second];
+        startSend(it->second, conn);
+        syncRecv(it->second, conn);
+    }
+}
+
+// 按 Session 的背压状态暂停 / 恢复 multishot recv
+void UringLoop::syncRecv(uint64_t connId, Conn& conn)
+{
+    if (conn.detached)
+        return;
+
+    if (conn.session->readPaused())
+    {
+        if (conn.recvArmed && !conn.recvCancelling)
+        {
+            cancel(encode(connId, kRecv));
+            conn.recvCancelling = true;
+        }
+    }
+    else if (!conn.recvArmed)
+    {
+        ring_.publishBuffers();
+        armRecv(connId, conn);
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────────────
+// 完成事件
+// ────────────────────────────────────────────────────────────────────────────
+void UringLoop::handleCqe(const io_uring_cqe& cqe)
+{
+    uint64_t connId = cqe.user_data >> 4;
+    Op       op     = static_cast<Op>(cqe.user_data & 0xF);
+    bool     more   = cqe.flags & IORING_CQE_F_MORE;
+
+    if (cqe.user_data == IoUring::kBufferUserData)
+        return;
+
+    switch (op)
+    {
+    case kAccept:
+        onAccept(cqe, more);
+        break;
+
+    case kWakeup:
+        handleWakeup();
+        if (!more)
+            armWakeup();
+        break;
+
+    case kTick:
+        armTick();
+        if (acceptPaused_ && running_)
+        {
+            acceptPaused_ = false;
+            armAccept();
+        }
+        break;
+
+    case kRecv:
+        onRecv(connId, cqe);
+        break;
+
+    case kSend:
+        onSend(connId, cqe);
+        break;
+
+    case kCancel:
+        break;
+    }
+}
+
+void UringLoop::onAccept(const io_uring_cqe& cqe, bool more)
+{
+    if (cqe.res >= 0)
+    {
+        acceptWorked_ = true;
+        onAccepted(cqe.res);
+        if (!more && running_)
+            armAccept();
+        return;
+    }
+
+    int err = -cqe.res;
+
+    // 旧内核不认识 IORING_ACCEPT_MULTISHOT，每次提交都立即 -EINVAL，原样重挂会空转
+    if (err == EINVAL && multishotAccept_ && !acceptWorked_)
+    {
+        std::cerr << "[UringLoop " << id_ << "] multishot accept unsupported, using single-shot accept" << std::endl;
+        multishotAccept_ = false;
+        if (running_)
+            armAccept();
+        return;
+    }
+
+    if (more)
+    {
+        std::cerr << "[UringLoop " << id_ << "] accept failed: " << strerror(err) << std::endl;
+        return;
+    }
+
+    // 对端在握手后立即断开等瞬时错误直接重挂
+    if (err == ECONNABORTED || err == EINTR || err == EAGAIN)
+    {
+        if (running_)
+            armAccept();
+        return;
+    }
+
+    // fd 耗尽、内存不足或其他错误：立即重挂会持续失败并空转，等下一个 tick 再试
+    std::cerr << "[UringLoop " << id_ << "] accept failed: " << strerror(err)
+              << ", retrying in " << TIMER_INTERVAL << "s" << std::endl;
+    acceptPaused_ = true;
+}
+
+void UringLoop::onRecv(uint64_t connId, const io_uring_cqe& cqe)
+{
+    auto it = conns_.find(connId);
+    if (it == conns_.end())
+        return;
+    Conn& conn = it->second;
+
+    bool hasBuffer = cqe.flags & IORING_CQE_F_BUFFER;
+    uint16_t bid   = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        conn.recvArmed      = false;
+        conn.recvCancelling = false;
+    }
+
+    if (cqe.res > 0 && !conn.detached)
+        conn.session->processInput(ring_.buffer(bid), static_cast<size_t>(cqe.res));
+
+    if (hasBuffer)
+        ring_.recycleBuffer(bid);
+
+    if (conn.detached)
+    {
+        releaseIfIdle(connId);
+        return;
+    }
+
+    if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)
+        || conn.session->closed())
+    {
+        // 对端关闭、出错，或 Session 解包失败自行关闭
+        closeConn(conn);
+        return;
+    }
+
+    // multishot 结束（如 provided buffer 暂时用尽）时重新挂上；背压暂停期间不挂
+    if (!conn.recvArmed)
+        syncRecv(connId, conn);
+}
+
+void UringLoop::onSend(uint64_t connId, const io_uring_cqe& cqe)
+{
+    auto it = conns_.find(connId);
+    if (it == conns_.end())
+        return;
+    Conn& conn = it->second;
+    conn.sendBusy = false;
+
+    if (conn.detached)
+    {
+        releaseIfIdle(connId);
+        return;
+    }
+
+    if (cqe.res < 0)
+    {
+        if (cqe.res != -EAGAIN && cqe.res != -EINTR)
+        {
+            closeConn(conn);
+            return;
+        }
+    }
+    else
+    {
+        conn.sending.consume(static_cast<size_t>(cqe.res));
+    }
+
+    // 字节真正写到 socket 后才从积压里扣除：可能降到低水位恢复读取，也可能已超过 hardLimit 断开
+    conn.session->onSendProgress(conn.sending.bytes());
+    if (conn.session->closed())
+    {
+        closeConn(conn);
+        return;
+    }
+
+    // 未发完的剩余部分，或期间新攒下的帧
+    startSend(connId, conn);
+    syncRecv(connId, conn);
+}
@@ -0,0 +1,94 @@
+#ifndef URING_LOOP_H
+#define URING_LOOP_H
+
+#include <sys/socket.h>
+#include <linux/time_types.h>
+#include <unordered_map>
+#include "eventloop.h"
+#include "uring.h"
+#include "chat/outputqueue.h"
+
+/**
+ * UringLoop — io_uring 驱动的 Sub-Reactor
+ *
+ *   - accept：监听 fd 上挂一个 multishot accept，一次提交持续产出新连接；内核不支持 multishot
+ *             （< 5.19，首次提交即 -EINVAL）时退回每次完成后重挂的单次 accept；
+ *             fd 耗尽（EMFILE / ENFILE）等错误暂停 accept，到下一个 tick 再挂；
+ *   - recv  ：每个连接一个 multishot recv，数据落在内核挑选的 provided buffer 里，
+ *             直接交给 ChatSession::processInput 解包，处理完归还缓冲区；
+ *   - send  ：Session 有待发数据时，把 outputQueue 整体换出（takeOutput），用一次 sendmsg 聚合发送，
+ *             完成前这些帧不再被改动，期间新产生的帧继续攒在 outputQueue 里；
+ *   - 唤醒 / tick：eventfd 上的 multishot poll 与 1 秒的 IORING_OP_TIMEOUT。
+ *
+ * 一轮循环只进入内核一次（提交 + 等待），不再有 epoll_ctl / readv / write 各自的系统调用。
+ */
+class UringLoop : public EventLoop {
+public:
+    // io_uring 不可用（内核版本、被禁用、资源不足）时抛 std::runtime_error
+    explicit UringLoop(int id);
+    ~UringLoop() override;
+
+    void loop() override;
+    void setListenFd(int listenFd) override;
+    int  updateEvents(ChatSession* session, bool wantRead, bool wantWrite) override;
+    // 发送统一走 ring 批量提交，不在 Session 里同步 write
+    bool writeThrough() const override { return false; }
+
+protected:
+    bool attachSession(const std::shared_ptr<ChatSession>& session) override;
+    void detachSession(const std::shared_ptr<ChatSession>& session) override;
+
+private:
+    static constexpr unsigned kRingEntries = 4096;
+    static constexpr unsigned kBufCount    = 1024;   // provided buffer 数量
+    static constexpr unsigned kBufSize     = 8192;
+
+    // user_data 低 4 位为操作类型，高位为连接编号
+    // user_data 为 0 的是 provided buffer 登记（IoUring::kBufferUserData），忽略
+    enum Op : uint64_t { kAccept = 1, kWakeup, kTick, kRecv, kSend, kCancel };
+
+    struct Conn {
+        std::shared_ptr<ChatSession> session;
+        int    fd        = -1;
+        OutputQueue sending;        // 正在发送的帧，完成前不能改动
+        iovec  iov[OutputQueue::kMaxIov];
+        msghdr msg{};
+        bool   recvArmed = false;
+        bool   recvCancelling = false;  // 背压暂停：已提交取消，等待 recv 结束
+        bool   sendBusy  = false;
+        bool   detached  = false;
+    };
+
+    static uint64_t encode(uint64_t connId, Op op) { return (connId << 4) | op; }
+
+    void armAccept();
+    void onAccept(const io_uring_cqe& cqe, bool more);
+    void armWakeup();
+    void armTick();
+    void armRecv(uint64_t connId, Conn& conn);
+    void startSend(uint64_t connId, Conn& conn);
+    void syncRecv(uint64_t connId, Conn& conn);
+    void cancel(uint64_t userData);
+
+    void handleCqe(const io_uring_cqe& cqe);
+    void onRecv(uint64_t connId, const io_uring_cqe& cqe);
+    void onSend(uint64_t connId, const io_uring_cqe& cqe);
+    void closeConn(Conn& conn);
+    void releaseIfIdle(uint64_t connId);
+    void flushPending();
+
+private:
+    IoUring  ring_;
+    int      listenFd_;
+    bool     multishotAccept_ = true;   // 首次 -EINVAL 后改为单次 accept
+    bool     acceptWorked_    = false;  // 已成功 accept 过，之后的 -EINVAL 不再视为不支持
+    bool     acceptPaused_    = false;  // 出错暂停中，由 tick 重挂
+    __kernel_timespec tick_;
+    uint64_t nextConnId_;
+
+    std::unordered_map<uint64_t, Conn>        conns_;
+    std::unordered_map<ChatSession*, uint64_t> connIds_;
+    std::vector<ChatSession*>                  pendingFlush_; // loop 线程内产生的待发送请求
+};
+
+#endif
@@ -0,0 +1,140 @@
+// jsonscan 单元测试：纯函数，不依赖网络与数据库
+#include "jsonscan.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #cond \
+                      << std::endl;                                              \
+            ++g_failures;                                                        \
+        }                                                                        \
+    } while (0)
+
+struct Scanned
+{
+    bool ok;
+    std::vector<std::pair<std::string, std::string>> fields;   // 键 → 原始值
+};
+
+static Scanned scan(std::string_view text)
+{
+    Scanned result;
+    result.ok = jsonscan::forEachField(text, [&](const jsonscan::Field &field) {
+        result.fields.emplace_back(std::string(field.key), std::string(field.raw));
+    });
+    return result;
+}
+
+// 以 content 为唯一字段的对象能否通过扫描
+static bool acceptsContent(const std::string &literal)
+{
+    return scan("{\"content\":" + literal + "}").ok;
+}
+
+static void testObjects()
+{
+    Scanned s = scan(R"( {"type":"CHAT", "to" : 42 ,"content":"hi","extra":{"a":[1,2.5e3,true,null]}} )");
+    CHECK(s.ok);
+    CHECK(s.fields.size() == 4);
+    CHECK(s.fields[0] == std::make_pair(std::string("type"), std::string("\"CHAT\"")));
+    CHECK(s.fields[1] == std::make_pair(std::string("to"), std::string("42")));
+    CHECK(s.fields[3].second == R"({"a":[1,2.5e3,true,null]})");
+
+    CHECK(scan("{}").ok);
+    CHECK(!scan("").ok);
+    CHECK(!scan("[]").ok);
+    CHECK(!scan("{\"a\":1,}").ok);
+    CHECK(!scan("{\"a\":1} x").ok);
+    CHECK(!scan("{\"a\" 1}").ok);
+    CHECK(!scan("{\"a\":01}").ok);
+    CHECK(!scan("{\"a\":1.}").ok);
+    CHECK(!scan("{\"a\":tru}").ok);
+    CHECK(!scan("{\"a\":{\"b\":1}").ok);
+}
+
+static void testDepth()
+{
+    std::string deep = "{\"a\":" + std::string(64, '[') + std::string(64, ']') + "}";
+    CHECK(scan(deep).ok);
+    std::string tooDeep = "{\"a\":" + std::string(65, '[') + std::string(65, ']') + "}";
+    CHECK(!scan(tooDeep).ok);
+}
+
+static void testEscapes()
+{
+    CHECK(acceptsContent(R"("a\"b\\c\/d\b\f\n\r\t")"));
+    CHECK(acceptsContent(R"("\u00e9\u4F60")"));
+    CHECK(!acceptsContent(R"("\x41")"));
+    CHECK(!acceptsContent(R"("\u12")"));
+    CHECK(!acceptsContent(R"("\u12g4")"));
+    CHECK(!acceptsContent("\"tab\there\""));   // 未转义的控制字符
+    CHECK(!acceptsContent("\"unterminated"));
+
+    bool escaped = false;
+    std::string key = R"({"k\u0065y":1})";
+    jsonscan::forEachField(key, [&](const jsonscan::Field &field) { escaped = field.keyEscaped; });
+    CHECK(escaped);
+}
+
+static void testSurrogates()
+{
+    CHECK(acceptsContent(R"("\ud83d\ude00")"));    // 合法代理对
+    CHECK(acceptsContent(R"("x\uD83D\uDE00y")"));
+    CHECK(!acceptsContent(R"("\ud800x")"));               // 孤立高代理
+    CHECK(!acceptsContent(R"("\ud800")"));
+    CHECK(!acceptsContent(R"("\ud800\u0041")"));          // 高代理后不是低代理
+    CHECK(!acceptsContent(R"("\ud800\ud800")"));
+    CHECK(!acceptsContent(R"("\ude00")"));                // 孤立低代理
+    CHECK(!acceptsContent(R"("\ude00\ud83d")"));          // 顺序颠倒
+}
+
+static void testUtf8()
+{
+    CHECK(acceptsContent("\"\xe4\xbd\xa0\xe5\xa5\xbd\""));
+    CHECK(acceptsContent("\"\xf0\x9f\x98\x80\""));
+    CHECK(!acceptsContent("\"\xff\""));
+    CHECK(!acceptsContent("\"\xc0\xaf\""));                // 超长编码
+    CHECK(!acceptsContent("\"\xed\xa0\x80\""));            // UTF-8 编码的代理码点
+    CHECK(!acceptsContent("\"\xf4\x90\x80\x80\""));        // 超过 U+10FFFF
+    CHECK(!acceptsContent("\"\xe4\xbd\""));                // 截断
+}
+
+static void testRawHelpers()
+{
+    std::string_view out;
+    CHECK(jsonscan::rawString("\"CHAT\"", out) && out == "CHAT");
+    CHECK(jsonscan::rawString("\"\"", out) && out.empty());
+    CHECK(!jsonscan::rawString("\"a\\nb\"", out));
+    CHECK(!jsonscan::rawString("42", out));
+
+    int value = 0;
+    CHECK(jsonscan::rawInt("42", value) && value == 42);
+    CHECK(jsonscan::rawInt("-7", value) && value == -7);
+    CHECK(!jsonscan::rawInt("4.2", value));
+    CHECK(!jsonscan::rawInt("\"42\"", value));
+    CHECK(!jsonscan::rawInt("99999999999", value));
+    CHECK(!jsonscan::rawInt("", value));
+}
+
+int main()
+{
+    testObjects();
+    testDepth();
+    testEscapes();
+    testSurrogates();
+    testUtf8();
+    testRawHelpers();
+
+    if (g_failures)
+    {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "jsonscan_test: all checks passed" << std::endl;
+    return 0;
+}
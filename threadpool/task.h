@@ -0,0 +1,108 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Task — 只可移动、带小对象优化的 void() 可调用对象
+ *
+ * 捕获不超过 kInlineSize 字节的 lambda 直接放在对象内部，投递任务时不分配堆内存；
+ * 更大的可调用对象才退回到堆上。与 std::function 不同，允许捕获 move-only 对象。
+ */
+class Task
+{
+public:
+    static constexpr size_t kInlineSize = 64;
+
+    Task() noexcept = default;
+
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F &&f)
+    {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t)
+                      && std::is_nothrow_move_constructible_v<Fn>)
+        {
+            ::new (static_cast<void *>(storage_)) Fn(std::forward<F>(f));
+            ops_ = &inlineOps<Fn>;
+        }
+        else
+        {
+            *reinterpret_cast<Fn **>(storage_) = new Fn(std::forward<F>(f));
+            ops_ = &heapOps<Fn>;
+        }
+    }
+
+    Task(Task &&rhs) noexcept { moveFrom(rhs); }
+
+    Task &operator=(Task &&rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            reset();
+            moveFrom(rhs);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() { reset(); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void operator()() { ops_->call(storage_); }
+
+private:
+    struct Ops
+    {
+        void (*call)(void *);
+        void (*move)(void *dst, void *src);   // 移动构造到 dst 并析构 src
+        void (*destroy)(void *);
+    };
+
+    template <class Fn>
+    static constexpr Ops inlineOps = {
+        [](void *p) { (*static_cast<Fn *>(p))(); },
+        [](void *dst, void *src) {
+            ::new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+            static_cast<Fn *>(src)->~Fn();
+        },
+        [](void *p) { static_cast<Fn *>(p)->~Fn(); },
+    };
+
+    template <class Fn>
+    static constexpr Ops heapOps = {
+        [](void *p) { (**static_cast<Fn **>(p))(); },
+        [](void *dst, void *src) { *static_cast<Fn **>(dst) = *static_cast<Fn **>(src); },
+        [](void *p) { delete *static_cast<Fn **>(p); },
+    };
+
+    void moveFrom(Task &rhs) noexcept
+    {
+        ops_ = rhs.ops_;
+        if (ops_)
+        {
+            ops_->move(storage_, rhs.storage_);
+            rhs.ops_ = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    const Ops *ops_ = nullptr;
+};
+
+#endif
@@ -2,15 +2,28 @@
 #define THREADPOOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <iostream>
+#include "task.h"
 
+/**
+ * Threadpool — 工作窃取线程池
+ *
+ * 每个 Worker 有自己的双端队列：自己从尾部取（LIFO，缓存友好），空闲时从其他
+ * Worker 的头部窃取。外部线程投递的任务轮询分散到各队列，没有全局锁；
+ * Worker 内部再投递的任务直接进自己的队列。
+ *
+ *   post()    ：投递 fire-and-forget 任务，不分配 future，小任务不分配堆内存
+ *   enqueue() ：需要拿到返回值时使用，返回 std::future
+ */
 class Threadpool
 {
 
@@ -18,46 +31,59 @@ public:
     explicit Threadpool(size_t threads_number);
     ~Threadpool();
 
+    void post(Task task);
+
     template <class F, class... Args>
     auto enqueue(F &&f, Args &&...args)
         -> std::future<decltype(std::invoke(std::forward<F>(f), std::forward<Args>(args)...))>;
     //  -> std::future<std::invoke_result_t<F, Args...>>
 
+    size_t size() const { return workers.size(); }
+
 private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task &task);
+    bool steal(size_t index, Task &task);
+
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> work_queue;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::atomic<size_t> nextQueue;   // 外部投递的轮询下标
+    std::atomic<size_t> pending;     // 已投递未取走的任务数
 
-    std::mutex queue_mutex;
+    // 仅用于空闲 Worker 休眠 / 唤醒
+    std::mutex sleep_mutex;
     std::condition_variable m_cond;
-    bool m_stop;
+    std::atomic<size_t> sleepers;
+    std::atomic<bool> m_stop;
+
+    // 当前线程所属的池与下标（非 Worker 线程为空）
+    static inline thread_local Threadpool *tl_pool = nullptr;
+    static inline thread_local size_t tl_index = 0;
 };
 
-inline Threadpool::Threadpool(size_t threads_number) : m_stop(false)
+inline Threadpool::Threadpool(size_t threads_number)
+    : nextQueue(0), pending(0), sleepers(0), m_stop(false)
 {
+    if (threads_number == 0)
+        threads_number = 1;
+
     for (size_t i = 0; i < threads_number; ++i)
-    {
-        workers.emplace_back([this]
-                             {
-            for(;;)
-            {
-                std::function<void()> task;
-                {
-                    std::unique_lock<std::mutex> lock(queue_mutex);
-                    m_cond.wait(lock, [this] { return m_stop || !work_queue.empty(); });
-                    if (m_stop && work_queue.empty())
-                        return;
-                    task = std::move(work_queue.front());
-                    work_queue.pop();
-                }
-                task();
-            } });
-    }
+        queues.push_back(std::make_unique<WorkQueue>());
+
+    for (size_t i = 0; i < threads_number; ++i)
+        workers.emplace_back([this, i] { workerLoop(i); });
 }
 
 inline Threadpool::~Threadpool()
 {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        std::unique_lock<std::mutex> lock(sleep_mutex);
         m_stop = true;
     }
     m_cond.notify_all();
@@ -65,24 +91,112 @@ inline Threadpool::~Threadpool()
         worker.join();
 }
 
+inline void Threadpool::post(Task task)
+{
+    // 停止后只接受 Worker 自己投递的任务（收尾时一并执行完）
+    if (m_stop.load(std::memory_order_relaxed) && tl_pool != this)
+        throw std::runtime_error("post on stopped Threadpool");
+
+    // Worker 内部投递进自己的队列，外部投递轮询分散
+    size_t index = (tl_pool == this) ? tl_index
+                                     : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    // 先计数再入队：窃取方的 fetch_sub 不会抢在前面把 pending 减到回绕；
+    // pending 与 sleepers 的先后顺序保证不会漏掉正要休眠的 Worker
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    if (sleepers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        m_cond.notify_one();
+    }
+}
+
+inline bool Threadpool::popLocal(size_t index, Task &task)
+{
+    WorkQueue &q = *queues[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+        return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+inline bool Threadpool::steal(size_t index, Task &task)
+{
+    for (size_t k = 1; k < queues.size(); ++k)
+    {
+        WorkQueue &q = *queues[(index + k) % queues.size()];
+        std::unique_lock<std::mutex> lock(q.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || q.tasks.empty())
+            continue;
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+inline void Threadpool::workerLoop(size_t index)
+{
+    tl_pool = this;
+    tl_index = index;
+
+    for (;;)
+    {
+        Task task;
+        if (popLocal(index, task) || steal(index, task))
+        {
+            pending.fetch_sub(1);
+            // 任务自己负责处理异常；漏出来的只记录，不能带走整个 Worker
+            try
+            {
+                task();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "[Threadpool] task threw: " << e.what() << std::endl;
+            }
+            catch (...)
+            {
+                std::cerr << "[Threadpool] task threw an unknown exception" << std::endl;
+            }
+            continue;
+        }
+
+        // 仍有任务但本轮没抢到（对方持锁），重试
+        if (pending.load() > 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleepers.fetch_add(1);
+        m_cond.wait(lock, [this] { return m_stop || pending.load() > 0; });
+        sleepers.fetch_sub(1);
+        if (m_stop && pending.load() == 0)
+            return;
+    }
+}
+
 template <class F, class... Args>
 auto Threadpool::enqueue(F &&f, Args &&...args)
     -> std::future<decltype(std::invoke(std::forward<F>(f), std::forward<Args>(args)...))>
 {
     using return_type = decltype(std::invoke(std::forward<F>(f), std::forward<Args>(args)...));
 
-    auto task = std::make_shared<std::packaged_task<return_type()>>(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    std::packaged_task<return_type()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    std::future<return_type> res = task.get_future();
 
-    std::future<return_type> res = task->get_future();
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        if (m_stop)
-            throw std::runtime_error("enqueue on stopped Threadpool");
-        work_queue.emplace([task]() { (*task)(); });
-    }
-    m_cond.notify_one();
+    // packaged_task 只可移动，Task 可以直接持有
+    post([task = std::move(task)]() mutable { task(); });
     return res;
 }
 
-#endif
\ No newline at end of file
+#endif